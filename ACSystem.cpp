@@ -0,0 +1,76 @@
+#include "ACSystem.h"
+#include <stdexcept>
+#include <cmath>
+
+ACSystem::ACSystem(int matrix_size, bool dense, const TripletList& atZero, const TripletList& atOne, const TripletList& atTwo)
+        : matrixSize(matrix_size), dense(dense) {
+    if (atOne.size() != atZero.size() || atTwo.size() != atZero.size()) {
+        throw logic_error("AC stamps change shape with frequency; cannot split into G + jwC.");
+    }
+
+    const complex<double> j(0, 1);
+    TripletList gEntries, cEntries;
+    gEntries.reserve(atZero.size());
+    cEntries.reserve(atZero.size());
+    for (size_t k = 0; k < atZero.size(); ++k) {
+        const auto& t0 = atZero[k];
+        const auto& t1 = atOne[k];
+        const auto& t2 = atTwo[k];
+        if (t1.row() != t0.row() || t1.col() != t0.col() || t2.row() != t0.row() || t2.col() != t0.col()) {
+            throw logic_error("AC stamps change shape with frequency; cannot split into G + jwC.");
+        }
+        complex<double> g = t0.value();
+        complex<double> c = (t1.value() - g) / j;
+        if (std::abs(t2.value() - (g + 2.0 * j * c)) > 1e-9 * (1.0 + std::abs(t2.value()))) {
+            throw logic_error("AC stamp is not affine in omega; cannot split into G + jwC.");
+        }
+        gEntries.emplace_back(t0.row(), t0.col(), g);
+        cEntries.emplace_back(t0.row(), t0.col(), c);
+    }
+
+    if (dense) {
+        denseG = MatrixXcd::Zero(matrixSize, matrixSize);
+        denseC = MatrixXcd::Zero(matrixSize, matrixSize);
+        for (size_t k = 0; k < gEntries.size(); ++k) {
+            denseG(gEntries[k].row(), gEntries[k].col()) += gEntries[k].value();
+            denseC(cEntries[k].row(), cEntries[k].col()) += cEntries[k].value();
+        }
+        return;
+    }
+
+    // Same index list for both, so the compressed patterns line up entry for entry.
+    sparseG.resize(matrixSize, matrixSize);
+    sparseC.resize(matrixSize, matrixSize);
+    sparseG.setFromTriplets(gEntries.begin(), gEntries.end());
+    sparseC.setFromTriplets(cEntries.begin(), cEntries.end());
+    sparseG.makeCompressed();
+    sparseC.makeCompressed();
+}
+
+long ACSystem::nonZeros() const {
+    return dense ? static_cast<long>(matrixSize) * matrixSize : sparseG.nonZeros();
+}
+
+void ACSystem::factorizeAt(double omega, ACWorkspace& workspace) const {
+    const complex<double> jw(0, omega);
+    if (dense) {
+        workspace.dense.noalias() = denseG + jw * denseC;
+        workspace.solver->factorize(workspace.dense);
+        return;
+    }
+
+    if (workspace.sparse.nonZeros() != sparseG.nonZeros()) {
+        workspace.sparse = sparseG;
+        workspace.analyzed = false;
+    }
+    const Index nnz = sparseG.nonZeros();
+    Map<VectorXcd> values(workspace.sparse.valuePtr(), nnz);
+    values = Map<const VectorXcd>(sparseG.valuePtr(), nnz) + jw * Map<const VectorXcd>(sparseC.valuePtr(), nnz);
+
+    if (workspace.analyzed) {
+        workspace.solver->refactorize(workspace.sparse);
+    } else {
+        workspace.solver->factorize(workspace.sparse);
+        workspace.analyzed = true;
+    }
+}
@@ -0,0 +1,55 @@
+#ifndef ACSYSTEM_H
+#define ACSYSTEM_H
+
+#include <vector>
+#include <memory>
+#include <complex>
+#include <Eigen/Dense>
+#include <Eigen/Sparse>
+#include "LinearSolver.h"
+
+using namespace std;
+using namespace Eigen;
+
+// Per-worker scratch for AC solves: the assembled matrix, a solver that keeps its symbolic
+// analysis between frequency points, and the solution of the last point.
+struct ACWorkspace {
+    unique_ptr<LinearSolver<complex<double>>> solver;
+    MatrixXcd dense;
+    SparseMatrix<complex<double>> sparse;
+    bool analyzed = false;
+    VectorXcd x;
+};
+
+// The small-signal MNA system split as A(omega) = G + j*omega*C, where G holds the
+// frequency-independent entries (conductances, source incidence, dependent sources) and C
+// the reactive ones (capacitances, and -L on inductor branch rows). Both share one sparsity
+// pattern, so each frequency point is assembled with a single pass over the nonzeros and the
+// sparse LU reuses its symbolic factorization. The split is read off AC stamps taken at
+// omega = 0 and omega = 1, which requires every stampAC to be affine in omega.
+class ACSystem {
+public:
+    using TripletList = vector<Triplet<complex<double>>>;
+
+    // atZero, atOne and atTwo are the recorded stampAC passes at omega = 0, 1 and 2; the
+    // third one only checks that the stamps really are affine in omega.
+    ACSystem(int matrix_size, bool dense, const TripletList& atZero, const TripletList& atOne, const TripletList& atTwo);
+
+    int size() const { return matrixSize; }
+    long nonZeros() const;
+
+    const VectorXcd& rhs() const { return b; }
+    void setRhs(const VectorXcd& newRhs) { b = newRhs; }
+
+    // Assembles G + j*omega*C into the workspace and factorizes it with workspace.solver.
+    void factorizeAt(double omega, ACWorkspace& workspace) const;
+
+private:
+    int matrixSize;
+    bool dense;
+    MatrixXcd denseG, denseC;
+    SparseMatrix<complex<double>> sparseG, sparseC;
+    VectorXcd b;
+};
+
+#endif
@@ -1,10 +1,13 @@
 #include "Circuit.h"
 #include "SubCircuit.h"
+#include "ParallelFor.h"
 #include <iostream>
 #include <iomanip>
+#include <sstream>
 #include <set>
 #include <map>
 #include <queue>
+#include <deque>
 #include <fstream>
 #include <cmath>
 #include <algorithm>
@@ -20,9 +23,497 @@ unique_ptr<Circuit> Circuit::clone() const {
     }
     newCircuit->wires = this->wires;
     newCircuit->m_externalPorts = this->m_externalPorts;
+    newCircuit->options = this->options;
     return newCircuit;
 }
 
+void Circuit::recordStamps(vector<Triplet<double>>& recorded, vector<int>& componentBegin) {
+    int matrix_size = nodeCount + currentVarCount;
+    RealStamper recorder(recorded);
+    VectorXd b = VectorXd::Zero(matrix_size);
+    VectorXd x_guess = VectorXd::Zero(matrix_size);
+    for (size_t i = 0; i < components.size(); ++i) {
+        componentBegin.push_back(static_cast<int>(recorded.size()));
+        components[i]->stamp(recorder, b, x_guess, branchRows[i], 1.0, 0.0);
+    }
+    componentBegin.push_back(static_cast<int>(recorded.size()));
+}
+
+void Circuit::selectLinearSolver(LinearSolverType requested) {
+    int matrix_size = nodeCount + currentVarCount;
+    long nonZeros = 0;
+    if (requested == LinearSolverType::Auto && matrix_size >= AUTO_SPARSE_THRESHOLD) {
+        // The auto mode needs the fill density, so stamp the pattern once up front.
+        vector<Triplet<double>> recorded;
+        vector<int> componentBegin;
+        recordStamps(recorded, componentBegin);
+        SparseMatrix<double> A(matrix_size, matrix_size);
+        A.setFromTriplets(recorded.begin(), recorded.end());
+        nonZeros = A.nonZeros();
+    }
+    activeSolver = resolveLinearSolverType(requested, matrix_size, nonZeros);
+    fillReported = false;
+    cout << "Linear solver: " << linearSolverTypeName(activeSolver);
+    if (isSparseSolverType(activeSolver) && activeSolver != LinearSolverType::Iterative) {
+        cout << " (ordering: " << matrixOrderingName(options.ordering) << ")";
+    }
+    cout << endl;
+}
+
+// Prints the fill ratio of the first sparse factorization of an analysis.
+void Circuit::reportFillRatio(double ratio) {
+    if (fillReported || ratio <= 0.0) return;
+    ostringstream formatted;
+    formatted << fixed << setprecision(2) << ratio;
+    cout << "Fill ratio (" << matrixOrderingName(options.ordering) << "): " << formatted.str() << endl;
+    fillReported = true;
+}
+
+void Circuit::compileStampPlan() {
+    vector<Triplet<double>> recorded;
+    vector<int> componentBegin;
+    recordStamps(recorded, componentBegin);
+    // One extra group after the components holds every node's diagonal, so the gmin of the
+    // operating point homotopy has a slot even where no component stamps the diagonal.
+    for (int i = 0; i < nodeCount; ++i) recorded.emplace_back(i, i, 0.0);
+    componentBegin.push_back(static_cast<int>(recorded.size()));
+    stampPlan = make_unique<StampPlan>(nodeCount + currentVarCount, !isSparseSolverType(activeSolver), recorded, componentBegin);
+    deviceGroups.build(components, branchRows, *stampPlan, grouped);
+
+    const int matrix_size = nodeCount + currentVarCount;
+    newton.solver = makeLinearSolver<double>(activeSolver, options.ordering);
+    newton.analyzed = false;
+    newton.b.setZero(matrix_size);
+    newton.x_next.setZero(matrix_size);
+    newton.unusedRhs.setZero(matrix_size);
+    newton.x_zero.setZero(matrix_size);
+    linearRhs.setZero(matrix_size);
+
+    // Resistors, source incidence and dependent sources never change during an analysis, so
+    // their matrix entries are stamped once here and kept as the base of every assembly.
+    stampPlan->clearValues();
+    for (size_t i = 0; i < components.size(); ++i) {
+        if (grouped[i] || components[i]->isNonLinear() || components[i]->isReactive()) continue;
+        stampComponent(i, newton.unusedRhs, newton.x_zero, 1.0, 0.0);
+    }
+    deviceGroups.stampStatic(*stampPlan);
+    stampPlan->saveValues(staticValues);
+    companionKey = {-1.0, 0.0};
+}
+
+void Circuit::stampComponent(size_t index, VectorXd& b, const VectorXd& x_guess, double h, double t) {
+    RealStamper stamper = stampPlan->stamperFor(index);
+    components[index]->stamp(stamper, b, x_guess, branchRows[index], h, t);
+    stampPlan->checkStamped(index, stamper);
+}
+
+// Companion conductances depend on h, and for Gear-2 also on the previous step; everything
+// else in them lives in the right-hand side. With no previous step (start of the run or right
+// after a breakpoint) every method takes a backward Euler step.
+pair<double, double> Circuit::companionKeyFor(double h) const {
+    const double lastStep = reactiveState.lastStep();
+    if (options.integration == IntegrationMethod::BackwardEuler || lastStep == 0.0) return {h, 0.0};
+    return {h, options.integration == IntegrationMethod::Gear2 ? lastStep : -1.0};
+}
+
+// The static base plus the companion part is rebuilt only when the companion key changes.
+void Circuit::updateCompanionValues(double h) {
+    if (companionKeyFor(h) == companionKey) return;
+    stampPlan->restoreValues(staticValues);
+    for (size_t i = 0; i < components.size(); ++i) {
+        if (!grouped[i] && components[i]->isReactive()) stampComponent(i, newton.unusedRhs, newton.x_zero, h, 0.0);
+    }
+    deviceGroups.stampCompanions(*stampPlan, reactiveState, h);
+    stampPlan->saveValues(linearValues);
+    companionKey = companionKeyFor(h);
+}
+
+void Circuit::stampLinearPart(const VectorXd& x_guess, double h, double t) {
+    updateCompanionValues(h);
+    linearRhs.setZero(nodeCount + currentVarCount);
+    RealStamper rhsOnly;
+    for (size_t i = 0; i < components.size(); ++i) {
+        if (grouped[i] || components[i]->isNonLinear()) continue;
+        components[i]->stamp(rhsOnly, linearRhs, x_guess, branchRows[i], h, t);
+    }
+    deviceGroups.stampCompanionRhs(linearRhs, reactiveState, h);
+    if (sourceScale != 1.0) linearRhs *= sourceScale;
+}
+
+void Circuit::solveNewtonIteration(const VectorXd& x_guess, double h, double t) {
+    stampPlan->restoreValues(linearValues);
+    if (gmin > 0) stampGmin();
+    VectorXd& b = newton.b;
+    b = linearRhs;
+    for (size_t i = 0; i < components.size(); ++i) {
+        if (!grouped[i] && components[i]->isNonLinear()) stampComponent(i, b, x_guess, h, t);
+    }
+    deviceGroups.stampDiodes(*stampPlan, b, x_guess);
+    stampPlan->factorize(*newton.solver, newton.analyzed);
+    newton.analyzed = true;
+    reportFillRatio(newton.solver->fillRatio());
+    newton.solver->solveInto(b, newton.x_next);
+}
+
+VectorXd Circuit::solveSystem(const VectorXd& x_guess, double h, double t) {
+    stampLinearPart(x_guess, h, t);
+    solveNewtonIteration(x_guess, h, t);
+    return newton.x_next;
+}
+
+// Without nonlinear parts the transient matrix only depends on h, so it is factorized once
+// per step size and every time point reduces to rebuilding b and a forward/back substitution.
+unique_ptr<LinearSolver<double>> Circuit::factorizeLinearSystem(double h) {
+    auto solver = makeLinearSolver<double>(activeSolver, options.ordering);
+    updateCompanionValues(h);
+    stampPlan->restoreValues(linearValues);
+    stampPlan->factorize(*solver);
+    reportFillRatio(solver->fillRatio());
+    return solver;
+}
+
+void Circuit::solveFactorized(const LinearSolver<double>& solver, const VectorXd& x_guess, double h, double t, VectorXd& x) {
+    VectorXd& b = newton.b;
+    b.setZero();
+    RealStamper rhsOnly;
+    for (size_t i = 0; i < components.size(); ++i) {
+        if (!grouped[i]) components[i]->stamp(rhsOnly, b, x_guess, branchRows[i], h, t);
+    }
+    deviceGroups.stampCompanionRhs(b, reactiveState, h);
+    solver.solveInto(b, x);
+}
+
+// Records the AC stamps at omega = 0, 1 and 2 and splits them into G + jwC once per sweep.
+void Circuit::compileACSystem() {
+    int matrix_size = nodeCount + currentVarCount;
+    ACSystem::TripletList stamped[3];
+    VectorXcd b = VectorXcd::Zero(matrix_size);
+    for (int k = 0; k < 3; ++k) {
+        ComplexStamper stamper(stamped[k]);
+        VectorXcd rhs = VectorXcd::Zero(matrix_size);
+        for (size_t i = 0; i < components.size(); ++i) {
+            components[i]->stampAC(stamper, rhs, branchRows[i], static_cast<double>(k));
+        }
+        if (k == 0) b = rhs;
+    }
+    acSystem = make_unique<ACSystem>(matrix_size, !isSparseSolverType(activeSolver), stamped[0], stamped[1], stamped[2]);
+    acSystem->setRhs(b);
+}
+
+// Re-stamps only the AC right-hand side, e.g. after a source phase changed.
+void Circuit::stampACRhs() {
+    VectorXcd b = VectorXcd::Zero(nodeCount + currentVarCount);
+    ComplexStamper rhsOnly;
+    for (size_t i = 0; i < components.size(); ++i) {
+        components[i]->stampAC(rhsOnly, b, branchRows[i], 0.0);
+    }
+    acSystem->setRhs(b);
+}
+
+// Only reads the circuit, so parallel sweep workers can call it with their own workspace.
+const VectorXcd& Circuit::solveACSystem(double omega, ACWorkspace& workspace) const {
+    if (!workspace.solver) {
+        workspace.solver = makeLinearSolver<complex<double>>(activeSolver, options.ordering);
+    }
+    acSystem->factorizeAt(omega, workspace);
+    workspace.solver->solveInto(acSystem->rhs(), workspace.x);
+    return workspace.x;
+}
+
+// Solves one time point starting from x_start; returns false if Newton-Raphson did not converge.
+// Purely linear circuits reuse one factorization per step size.
+bool Circuit::solveTimePoint(const VectorXd& x_start, double h, double t, bool hasNonLinear, FactorizationCache& factorizations, VectorXd& x) {
+    if (!hasNonLinear) {
+        unique_ptr<LinearSolver<double>>& lu = factorizations[companionKeyFor(h)];
+        if (!lu) {
+            lu = factorizeLinearSystem(h);
+        }
+        solveFactorized(*lu, x_start, h, t, x);
+        return true;
+    }
+
+    x = x_start;
+    return solveNewton(x, h, t);
+}
+
+// Newton-Raphson from the guess in x; on return x holds the last iterate. Converged once no
+// junction was limited and every variable moved by less than reltol * |value| plus vntol
+// (node voltages) or abstol (branch currents).
+bool Circuit::solveNewton(VectorXd& x, double h, double t) {
+    const int MAX_NR_ITER = 100;
+    newtonSolves++;
+    stampLinearPart(x, h, t);
+    VectorXd& x_next = newton.x_next;
+    for (int i = 0; i < MAX_NR_ITER; ++i) {
+        solveNewtonIteration(x, h, t);
+        newtonIterations++;
+        if (options.newtonDamping > 0 && nodeCount > 0) {
+            double maxChange = (x_next - x).head(nodeCount).cwiseAbs().maxCoeff();
+            if (maxChange > options.newtonDamping) {
+                x_next = x + (options.newtonDamping / maxChange) * (x_next - x);
+            }
+        }
+        bool converged = !junctionLimited() && newtonConverged(x_next, x);
+        x.swap(x_next);
+        if (converged) return true;
+    }
+    return false;
+}
+
+void Circuit::stampGmin() {
+    RealStamper stamper = stampPlan->stamperFor(components.size());
+    for (int i = 0; i < nodeCount; ++i) stamper.add(i, i, gmin);
+}
+
+// Plain Newton first. If it fails, gmin stepping shunts every node to ground with a large
+// conductance that makes the system nearly linear, and lowers it a decade per solve, each
+// solve starting from the last. If that fails too, source stepping ramps every independent
+// source up from zero, where the solution is known. Both leave gmin = 0 and full sources.
+bool Circuit::solveOperatingPoint(VectorXd& x, double t) {
+    const VectorXd x_start = x;
+    if (solveNewton(x, DC_MODE, t)) return true;
+
+    if (options.gminStart > 0) {
+        x = x_start;
+        bool converged;
+        gmin = options.gminStart;
+        while ((converged = solveNewton(x, DC_MODE, t)) && gmin > options.gminFinal) {
+            gmin = max(gmin / 10.0, options.gminFinal);
+        }
+        gmin = 0.0;
+        if (converged && solveNewton(x, DC_MODE, t)) {
+            cout << "DC operating point: converged with gmin stepping" << endl;
+            return true;
+        }
+    }
+
+    if (options.sourceSteps > 0) {
+        x = VectorXd::Zero(x.size());
+        bool converged = true;
+        for (int step = 1; converged && step <= options.sourceSteps; ++step) {
+            sourceScale = static_cast<double>(step) / options.sourceSteps;
+            converged = solveNewton(x, DC_MODE, t);
+        }
+        sourceScale = 1.0;
+        if (converged) {
+            cout << "DC operating point: converged with source stepping" << endl;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Appends (t, x) to a history kept at most `length` points long; once it is full the storage
+// of the dropped oldest point is reused, so long runs do not allocate per point.
+static void pushHistory(deque<pair<double, VectorXd>>& history, double t, const VectorXd& x, size_t length) {
+    if (history.size() < length) {
+        history.emplace_back(t, x);
+        return;
+    }
+    pair<double, VectorXd> oldest = move(history.front());
+    history.pop_front();
+    oldest.first = t;
+    oldest.second = x;
+    history.push_back(move(oldest));
+}
+
+// The sweep point starts from the predictor through the previous sweep solutions, so Newton
+// only has to follow the change from one value to the next. When it fails, the step from the
+// last converged value is halved (the intermediate values are solved but not reported), down
+// to 1/1024 of the full step; only then does the point fall back to the operating point
+// homotopies.
+bool Circuit::continueSweep(const ParameterHandle& parameter, double value, deque<pair<double, VectorXd>>& history, VectorXd& x, int& subdivisions) {
+    if (history.empty()) {
+        parameter.set(value);
+        x = VectorXd::Zero(nodeCount + currentVarCount);
+        if (!solveOperatingPoint(x, 0.0)) return false;
+        pushHistory(history, value, x, HISTORY_LENGTH);
+        return true;
+    }
+
+    double reached = history.back().first;
+    const double fullStep = value - reached;
+    double step = fullStep;
+    while (reached != value) {
+        double next = (std::abs(value - reached) <= std::abs(step) * (1.0 + 1e-9)) ? value : reached + step;
+        parameter.set(next);
+        predictSolution(history, next, x);
+        if (solveNewton(x, DC_MODE, 0.0)) {
+            reached = next;
+            pushHistory(history, next, x, HISTORY_LENGTH);
+        } else if (std::abs(step) > std::abs(fullStep) / 1024.0) {
+            step /= 2.0;
+            subdivisions++;
+        } else {
+            parameter.set(value);
+            x = history.back().second;
+            if (!solveOperatingPoint(x, 0.0)) return false;
+            pushHistory(history, value, x, HISTORY_LENGTH);
+            return true;
+        }
+    }
+    return true;
+}
+
+bool Circuit::junctionLimited() const {
+    if (deviceGroups.getDiodes().isLimiting()) return true;
+    for (const auto& comp : components) {
+        if (comp->isLimiting()) return true;
+    }
+    return false;
+}
+
+bool Circuit::newtonConverged(const VectorXd& x_new, const VectorXd& x_old) const {
+    for (Index i = 0; i < x_new.size(); ++i) {
+        double floor = (i < nodeCount) ? options.vntol : options.abstol;
+        double tolerance = options.reltol * max(std::abs(x_new(i)), std::abs(x_old(i))) + floor;
+        // Negated so that a NaN or Inf update fails the test instead of passing it.
+        if (!(std::abs(x_new(i) - x_old(i)) <= tolerance)) return false;
+    }
+    return true;
+}
+
+// Resets the nonlinear device state and counters and hands them the bypass tolerance.
+void Circuit::prepareNonlinearDevices() {
+    for (auto& comp : components) {
+        if (!comp->isNonLinear()) continue;
+        comp->resetState();
+        comp->setBypassTolerance(options.reltol, options.bypassTolerance);
+    }
+    deviceGroups.resetDiodes(options.reltol, options.bypassTolerance);
+}
+
+pair<long, long> Circuit::deviceBypassCounts() const {
+    long evaluations = deviceGroups.getDiodes().evaluationCount();
+    long bypassed = deviceGroups.getDiodes().bypassCount();
+    for (const auto& comp : components) {
+        evaluations += comp->evaluationCount();
+        bypassed += comp->bypassCount();
+    }
+    return {evaluations, bypassed};
+}
+
+void Circuit::reportNewtonStatistics() const {
+    if (newtonSolves == 0) return;
+    auto [evaluations, bypassed] = deviceBypassCounts();
+    evaluations += mergedEvaluations;
+    bypassed += mergedBypasses;
+    ostringstream line;
+    line << "Newton iterations: " << newtonIterations << " over " << newtonSolves << " solves ("
+         << fixed << setprecision(1) << static_cast<double>(newtonIterations) / newtonSolves << " per solve)";
+    if (evaluations > 0) {
+        line << ", device bypass: " << bypassed << " of " << evaluations << " stamps";
+    }
+    cout << line.str() << endl;
+}
+
+void Circuit::applyIntegrationMethod(IntegrationMethod method) {
+    reactiveState.setMethod(method);
+}
+
+void Circuit::restartIntegration() {
+    reactiveState.restart();
+}
+
+double Circuit::nextBreakpoint(double t) const {
+    double next = numeric_limits<double>::infinity();
+    for (const auto& comp : components) {
+        next = min(next, comp->nextBreakpoint(t));
+    }
+    return next;
+}
+
+double Circuit::maxSourceStep() const {
+    double step = numeric_limits<double>::infinity();
+    for (const auto& comp : components) {
+        step = min(step, comp->maxTimeStep());
+    }
+    return step;
+}
+
+// Moves capacitor and inductor histories to a time point accepted with step h.
+void Circuit::acceptTimePoint(const VectorXd& x, double h) {
+    reactiveState.accept(x, h);
+}
+
+// Registers Time and every node voltage and branch current as transient result columns and
+// lays them out as rows of x, so each recorded point is a plain appendRow.
+void Circuit::registerTransientResults(ResultStore& results) const {
+    vector<int> columnIds, xRows;
+    for (int i = 0; i < nodeCount; ++i) {
+        columnIds.push_back(results.add("V(" + to_string(nodeIds[i]) + ")"));
+        xRows.push_back(i);
+    }
+    for (const auto& pair : currentComponentMap) {
+        columnIds.push_back(results.add("I(" + pair.first + ")"));
+        xRows.push_back(nodeCount + pair.second - 1);
+    }
+    results.setRowLayout(results.add("Time"), columnIds, xRows);
+}
+
+// Newton starting guess at t_new, extrapolated through the last accepted points with a
+// polynomial of degree options.predictorOrder (0 repeats the newest point). Only nonlinear
+// circuits use it; after a breakpoint the history is short and the order drops with it.
+// DC sweeps call it with the sweep value in place of the time.
+void Circuit::predictSolution(const deque<pair<double, VectorXd>>& history, double t_new, VectorXd& guess) const {
+    const int points = min<int>(options.predictorOrder + 1, static_cast<int>(history.size()));
+    const size_t first = history.size() - points;
+    guess.setZero(history.back().second.size());
+    for (int i = 0; i < points; ++i) {
+        double weight = 1.0;
+        for (int j = 0; j < points; ++j) {
+            if (j == i) continue;
+            weight *= (t_new - history[first + j].first) / (history[first + i].first - history[first + j].first);
+        }
+        guess += weight * history[first + i].second;
+    }
+}
+
+// Largest local truncation error over the reactive states (capacitor voltages, inductor
+// currents) relative to its tolerance, for the step from the newest history point to t_new.
+// The (order + 1)-th derivative comes from divided differences over the last order + 2 points.
+double Circuit::truncationErrorRatio(const deque<pair<double, VectorXd>>& history, double t_new, const VectorXd& x_new) const {
+    const int order = integrationOrder(options.integration);
+    const int levels = order + 1;
+    if (static_cast<int>(history.size()) < levels) return 0.0;
+
+    double errorConstant = 0.5;
+    if (options.integration == IntegrationMethod::Trapezoidal) errorConstant = 1.0 / 12.0;
+    else if (options.integration == IntegrationMethod::Gear2) errorConstant = 2.0 / 9.0;
+
+    // Fixed-size scratch, since this runs on every step: all methods are at most second order.
+    const int MAX_POINTS = 4;
+    double times[MAX_POINTS];
+    const VectorXd* points[MAX_POINTS];
+    double dd[MAX_POINTS];
+    for (int k = 0; k < levels; ++k) {
+        times[k] = history[history.size() - levels + k].first;
+        points[k] = &history[history.size() - levels + k].second;
+    }
+    times[levels] = t_new;
+    points[levels] = &x_new;
+    const double h = t_new - history.back().first;
+    double factorial = 1.0;
+    for (int k = 2; k <= levels; ++k) factorial *= k;
+
+    double ratio = 0.0;
+    for (int slot = 0; slot < reactiveState.size(); ++slot) {
+        for (int k = 0; k <= levels; ++k) dd[k] = reactiveState.stateOf(slot, *points[k]);
+        double s_new = dd[levels];
+        double s_n = dd[levels - 1];
+        for (int level = 1; level <= levels; ++level) {
+            for (int k = 0; k + level <= levels; ++k) {
+                dd[k] = (dd[k + 1] - dd[k]) / (times[k + level] - times[k]);
+            }
+        }
+        double lte = errorConstant * pow(h, levels) * factorial * std::abs(dd[0]);
+        double floor = reactiveState.isCurrentState(slot) ? options.abstol : options.vntol;
+        double tolerance = options.trtol * (options.reltol * max(std::abs(s_new), std::abs(s_n)) + floor);
+        ratio = max(ratio, lte / tolerance);
+    }
+    return ratio;
+}
+
 void Circuit::runTransientAnalysis(double Tstop, double Tstep, const vector<PrintVariable>& printVars, double Tstart, double Tmaxstep) {
     unique_ptr<Circuit> flatCircuit = this->clone();
     flatCircuit->analyzeCircuit();
@@ -32,12 +523,14 @@ void Circuit::runTransientAnalysis(double Tstop, double Tstep, const vector<Prin
         cout << "Circuit is empty. Cannot run analysis." << endl;
         return;
     }
+    flatCircuit->selectLinearSolver(options.transientSolver);
+    flatCircuit->compileStampPlan();
+    flatCircuit->applyIntegrationMethod(options.integration);
+    flatCircuit->prepareNonlinearDevices();
+    cout << "Integration method: " << integrationMethodName(options.integration) << endl;
 
     this->simulationResults.clear();
-    double actual_tstep = Tstep;
-    if (Tmaxstep > 0 && Tmaxstep < Tstep) {
-        actual_tstep = Tmaxstep;
-    }
+    flatCircuit->registerTransientResults(this->simulationResults);
 
     bool hasNonLinear = false;
     for (const auto& comp : flatCircuit->components) {
@@ -47,74 +540,184 @@ void Circuit::runTransientAnalysis(double Tstop, double Tstep, const vector<Prin
         }
     }
 
-    VectorXd x = VectorXd::Zero(matrix_size);
-    VectorXd x_prev_t = VectorXd::Zero(matrix_size);
-
-    for (double t = 0; t <= Tstop; t += actual_tstep) {
-        VectorXd x_nr_guess = x_prev_t;
-        if (hasNonLinear) {
-            const int MAX_NR_ITER = 100;
-            const double NR_TOLERANCE = 1e-6;
-            for (int i = 0; i < MAX_NR_ITER; ++i) {
-                MatrixXd A = MatrixXd::Zero(matrix_size, matrix_size);
-                VectorXd b = VectorXd::Zero(matrix_size);
-                for (const auto& comp : flatCircuit->components) {
-                    int final_current_idx = -1;
-                    if (comp->addsCurrentVariable()) {
-                        final_current_idx = flatCircuit->nodeCount + flatCircuit->currentComponentMap.at(comp->getName()) - 1;
-                    }
-                    comp->stamp(A, b, x_nr_guess, final_current_idx, actual_tstep, t);
-                }
-                VectorXd x_next_nr = A.colPivHouseholderQr().solve(b);
-                if ((x_next_nr - x_nr_guess).norm() < NR_TOLERANCE) {
-                    x_nr_guess = x_next_nr;
-                    break;
-                }
-                x_nr_guess = x_next_nr;
-                if (i == MAX_NR_ITER - 1) {
-                    cout << "Warning: Newton-Raphson did not converge at t=" << t << endl;
-                }
-            }
+    // The run starts from zero, or with uic off from the DC operating point at t = 0:
+    // capacitors and inductors take its voltages and currents as their history, and the first
+    // step is a backward Euler step.
+    VectorXd x_initial = VectorXd::Zero(matrix_size);
+    if (!options.useInitialConditions) {
+        if (flatCircuit->solveOperatingPoint(x_initial, 0.0)) {
+            flatCircuit->acceptTimePoint(x_initial, DC_MODE);
+            flatCircuit->restartIntegration();
         } else {
-            MatrixXd A = MatrixXd::Zero(matrix_size, matrix_size);
-            VectorXd b = VectorXd::Zero(matrix_size);
-            for (const auto& comp : flatCircuit->components) {
-                int final_current_idx = -1;
-                if (comp->addsCurrentVariable()) {
-                    final_current_idx = flatCircuit->nodeCount + flatCircuit->currentComponentMap.at(comp->getName()) - 1;
-                }
-                comp->stamp(A, b, x_nr_guess, final_current_idx, actual_tstep, t);
-            }
-            x_nr_guess = A.colPivHouseholderQr().solve(b);
+            cout << "Warning: DC operating point did not converge; starting from zero." << endl;
+            x_initial.setZero();
         }
+    }
 
-        x = x_nr_guess;
+    FactorizationCache factorizations;
+    const size_t MAX_CACHED_FACTORIZATIONS = 32;
 
-        if (t >= Tstart) {
-            this->simulationResults["Time"].push_back(t);
-            for (int i = 0; i < flatCircuit->nodeCount; ++i) {
-                string varName = "V(" + to_string(i + 1) + ")";
-                this->simulationResults[varName].push_back(x(i));
+    // Fixed stepping: a step that would cross a source breakpoint ends on it first (that point
+    // is solved but not recorded), integration restarts there with backward Euler and a fresh
+    // predictor history, and the next step runs from the breakpoint up to the grid point.
+    if (!options.adaptiveStep) {
+        double actual_tstep = Tstep;
+        if (Tmaxstep > 0 && Tmaxstep < Tstep) {
+            actual_tstep = Tmaxstep;
+        }
+        this->simulationResults.reserveRows(static_cast<size_t>(max(Tstop - max(Tstart, 0.0), 0.0) / actual_tstep) + 2);
+        const double slack = 1e-9 * actual_tstep;
+        VectorXd x_prev_t = x_initial;
+        VectorXd x(matrix_size), guess(matrix_size);
+        deque<pair<double, VectorXd>> history;
+        double breakpoint = flatCircuit->nextBreakpoint(slack);
+        // Last solved time point, and whether it was a breakpoint between grid points.
+        double t_last = 0.0;
+        bool offGrid = false;
+        int breakpointsHit = 0;
+        for (double t = 0; t <= Tstop; t += actual_tstep) {
+            if (factorizations.size() > MAX_CACHED_FACTORIZATIONS) factorizations.clear();
+            for (; breakpoint < t - slack; breakpoint = flatCircuit->nextBreakpoint(breakpoint + slack)) {
+                const double h_breakpoint = breakpoint - t_last;
+                if (history.empty()) guess = x_prev_t;
+                else flatCircuit->predictSolution(history, breakpoint, guess);
+                if (!flatCircuit->solveTimePoint(guess, h_breakpoint, breakpoint, hasNonLinear, factorizations, x)) {
+                    cout << "Warning: Newton-Raphson did not converge at t=" << breakpoint << endl;
+                }
+                flatCircuit->acceptTimePoint(x, h_breakpoint);
+                flatCircuit->restartIntegration();
+                x_prev_t = x;
+                history.clear();
+                history.emplace_back(breakpoint, x);
+                t_last = breakpoint;
+                offGrid = true;
+                breakpointsHit++;
             }
-            for (const auto& pair : flatCircuit->currentComponentMap) {
-                string varName = "I(" + pair.first + ")";
-                this->simulationResults[varName].push_back(x(flatCircuit->nodeCount + pair.second - 1));
+            // Grid-to-grid steps keep exactly actual_tstep, so they share one factorization.
+            const double h = offGrid ? t - t_last : actual_tstep;
+            if (history.empty()) guess = x_prev_t;
+            else flatCircuit->predictSolution(history, t, guess);
+            if (!flatCircuit->solveTimePoint(guess, h, t, hasNonLinear, factorizations, x)) {
+                cout << "Warning: Newton-Raphson did not converge at t=" << t << endl;
             }
-        }
-
-        x_prev_t = x;
-        for (auto& comp : flatCircuit->components) {
-            if (auto cap = dynamic_cast<Capacitor*>(comp.get())) {
-                double v1 = (cap->getNode(0) > 0) ? x(cap->getNode(0) - 1) : 0.0;
-                double v2 = (cap->getNode(1) > 0) ? x(cap->getNode(1) - 1) : 0.0;
-                cap->updateVoltage(v1 - v2);
+            if (t >= Tstart) {
+                this->simulationResults.appendRow(t, x);
             }
-            if (auto ind = dynamic_cast<Inductor*>(comp.get())) {
-                int m_idx = flatCircuit->currentComponentMap.at(ind->getName());
-                ind->updateCurrent(x(flatCircuit->nodeCount + m_idx - 1));
+            flatCircuit->acceptTimePoint(x, h);
+            x_prev_t = x;
+            pushHistory(history, t, x, HISTORY_LENGTH);
+            t_last = t;
+            offGrid = false;
+            if (breakpoint <= t + slack) {
+                flatCircuit->restartIntegration();
+                history.clear();
+                history.emplace_back(t, x);
+                breakpoint = flatCircuit->nextBreakpoint(t + slack);
+                breakpointsHit++;
             }
         }
+        if (breakpointsHit > 0) cout << "Transient breakpoints: " << breakpointsHit << endl;
+        flatCircuit->reportNewtonStatistics();
+        cout << "Transient analysis finished." << endl;
+        return;
+    }
+
+    // Adaptive stepping: the step grows by up to 2x while the truncation error stays below
+    // tolerance and is cut back (and the step retried) when it does not or when Newton fails.
+    // As in SPICE the step never exceeds Tstep, (Tstop - Tstart) / 50 or Tmaxstep, nor the step
+    // a sine source needs, since the error estimate sees only the reactive states (a purely
+    // resistive circuit has none). Results are interpolated onto the user's Tstep grid. Steps
+    // land exactly on source breakpoints, and integration restarts there with a small backward
+    // Euler step and a fresh error history, since nothing is smooth across the corner.
+    const double span = (Tstop > Tstart) ? Tstop - max(Tstart, 0.0) : Tstop;
+    double h_max = min({Tstep, span / 50.0, flatCircuit->maxSourceStep()});
+    if (Tmaxstep > 0) h_max = min(h_max, Tmaxstep);
+    const double h_min = h_max * 1e-9;
+    const long lastGridPoint = static_cast<long>(floor(Tstop / Tstep + 1e-9));
+    const double gridSlack = 1e-9 * Tstep;
+    this->simulationResults.reserveRows(static_cast<size_t>(max(Tstop - max(Tstart, 0.0), 0.0) / Tstep) + 2);
+
+    const double h_start = h_max / 10.0;
+    double h = h_start;
+    VectorXd x_n;
+    flatCircuit->solveTimePoint(x_initial, h, 0.0, hasNonLinear, factorizations, x_n);
+    flatCircuit->acceptTimePoint(x_n, h);
+    if (Tstart <= 0) {
+        this->simulationResults.appendRow(0.0, x_n);
+    }
+    long nextGridPoint = 1;
+
+    // Last accepted points, oldest first, for the truncation error estimate and the predictor.
+    deque<pair<double, VectorXd>> history;
+    history.emplace_back(0.0, x_n);
+    const double growthExponent = 1.0 / (integrationOrder(options.integration) + 1);
+    double t = 0.0;
+    double breakpoint = flatCircuit->nextBreakpoint(h_min);
+    int acceptedSteps = 0, rejectedSteps = 0, breakpointsHit = 0;
+    // Per-step vectors live across the loop so accepted and rejected steps reuse their storage.
+    VectorXd x_guess(matrix_size), x_new(matrix_size), x_grid(matrix_size);
+
+    while (t < Tstop - h_min) {
+        if (t + h > Tstop - h_min) h = Tstop - t;
+        // Land on the breakpoint, or split the approach in two rather than leave a sliver.
+        bool onBreakpoint = false;
+        if (breakpoint - t <= h + h_min) {
+            h = breakpoint - t;
+            onBreakpoint = true;
+        } else if (breakpoint - t < 2.0 * h) {
+            h = (breakpoint - t) / 2.0;
+        }
+        if (factorizations.size() > MAX_CACHED_FACTORIZATIONS) factorizations.clear();
+
+        flatCircuit->predictSolution(history, t + h, x_guess);
+        bool converged = flatCircuit->solveTimePoint(x_guess, h, t + h, hasNonLinear, factorizations, x_new);
+        if (!converged && h > h_min) {
+            h = max(h / 8.0, h_min);
+            rejectedSteps++;
+            continue;
+        }
+        if (!converged) {
+            cout << "Warning: Newton-Raphson did not converge at t=" << t + h << endl;
+        }
+
+        double ratio = flatCircuit->truncationErrorRatio(history, t + h, x_new);
+        if (ratio > 1.0 && h > h_min) {
+            h = max(h * max(0.25, 0.9 * pow(ratio, -growthExponent)), h_min);
+            rejectedSteps++;
+            continue;
+        }
+
+        for (; nextGridPoint <= lastGridPoint; ++nextGridPoint) {
+            double t_grid = nextGridPoint * Tstep;
+            if (t_grid > t + h + gridSlack) break;
+            if (t_grid < Tstart) continue;
+            double alpha = min(max((t_grid - t) / h, 0.0), 1.0);
+            x_grid = x_n + alpha * (x_new - x_n);
+            this->simulationResults.appendRow(t_grid, x_grid);
+        }
+
+        flatCircuit->acceptTimePoint(x_new, h);
+        x_n = x_new;
+        t += h;
+        pushHistory(history, t, x_new, HISTORY_LENGTH);
+        acceptedSteps++;
+
+        double growth = (ratio > 0.0) ? min(2.0, 0.9 * pow(ratio, -growthExponent)) : 2.0;
+        h = min(h * growth, h_max);
+
+        if (onBreakpoint) {
+            flatCircuit->restartIntegration();
+            history.clear();
+            history.emplace_back(t, x_new);
+            h = min(h, h_start);
+            breakpoint = flatCircuit->nextBreakpoint(t + h_min);
+            breakpointsHit++;
+        }
     }
+    cout << "Transient steps: " << acceptedSteps << " accepted, " << rejectedSteps << " rejected";
+    if (breakpointsHit > 0) cout << ", " << breakpointsHit << " breakpoints";
+    cout << endl;
+    flatCircuit->reportNewtonStatistics();
     cout << "Transient analysis finished." << endl;
 }
 
@@ -127,6 +730,8 @@ void Circuit::runACAnalysis(double startFreq, double stopFreq, int numPoints, co
         cout << "Circuit is empty. Cannot run analysis." << endl;
         return;
     }
+    flatCircuit->selectLinearSolver(options.acSolver);
+    flatCircuit->compileACSystem();
 
     bool hasACSource = false;
     for (const auto& comp : flatCircuit->components) {
@@ -144,7 +749,7 @@ void Circuit::runACAnalysis(double startFreq, double stopFreq, int numPoints, co
 
     if (printVars.empty()) {
         for (int i = 0; i < flatCircuit->nodeCount; ++i) {
-            this->simulationResults["V(" + to_string(i + 1) + ")"];
+            this->simulationResults["V(" + to_string(flatCircuit->nodeIds[i]) + ")"];
         }
         for (const auto& pair : flatCircuit->currentComponentMap) {
             this->simulationResults["I(" + pair.first + ")"];
@@ -161,6 +766,7 @@ void Circuit::runACAnalysis(double startFreq, double stopFreq, int numPoints, co
 
     cout << "--- Starting AC Sweep Analysis ---" << endl;
 
+    vector<double> frequencies;
     for (int i = 0; i < numPoints; ++i) {
         double freq = 0;
         if (numPoints == 1) {
@@ -174,41 +780,56 @@ void Circuit::runACAnalysis(double startFreq, double stopFreq, int numPoints, co
         }
 
         if (freq == 0 && startFreq != 0) continue;
-        double omega = 2 * M_PI * freq;
+        frequencies.push_back(freq);
+    }
 
-        MatrixXcd A = MatrixXcd::Zero(matrix_size, matrix_size);
-        VectorXcd b = VectorXcd::Zero(matrix_size);
+    // Resolve every result column to its row in x once, so the workers only index into it.
+    vector<vector<double>*> columns;
+    vector<int> rows;
+    for (auto& [key, val] : this->simulationResults) {
+        if (key == "Frequency") continue;
 
-        for (const auto& comp : flatCircuit->components) {
-            int final_current_idx = -1;
-            if (comp->addsCurrentVariable()) {
-                final_current_idx = flatCircuit->nodeCount + flatCircuit->currentComponentMap.at(comp->getName()) - 1;
-            }
-            comp->stampAC(A, b, final_current_idx, omega);
-        }
+        char type = toupper(key[0]);
+        string id = key.substr(key.find("(") + 1, key.find(")") - key.find("(") - 1);
 
-        VectorXcd x = A.colPivHouseholderQr().solve(b);
+        int row = -1;
+        if (type == 'V') {
+            row = flatCircuit->nodeRowOf(stoi(id));
+        } else if (type == 'I' && flatCircuit->currentComponentMap.count(id)) {
+            row = flatCircuit->nodeCount + flatCircuit->currentComponentMap.at(id) - 1;
+        }
+        if (row >= 0) {
+            columns.push_back(&val);
+            rows.push_back(row);
+        }
+    }
 
-        this->simulationResults["Frequency"].push_back(freq);
-        for (auto const& [key, val] : this->simulationResults) {
-            if (key == "Frequency") continue;
+    // Frequency points are independent: each worker solves with its own solver and right-hand
+    // side, writes magnitudes into its points' slots, and the slots are merged in sweep order.
+    unsigned threads = resolveThreadCount(options.threads, frequencies.size());
+    cout << "AC sweep: " << frequencies.size() << " points on " << threads << " thread(s)" << endl;
+    vector<ACWorkspace> workspaces(threads);
+    vector<double> magnitudes(frequencies.size() * rows.size());
+    parallelFor(frequencies.size(), threads, [&](unsigned worker, size_t point) {
+        const VectorXcd& x = flatCircuit->solveACSystem(2 * M_PI * frequencies[point], workspaces[worker]);
+        for (size_t k = 0; k < rows.size(); ++k) {
+            magnitudes[point * rows.size() + k] = std::abs(x(rows[k]));
+        }
+    });
 
-            char type = toupper(key[0]);
-            string id = key.substr(key.find("(") + 1, key.find(")") - key.find("(") - 1);
+    for (const auto& workspace : workspaces) {
+        if (workspace.solver) {
+            flatCircuit->reportFillRatio(workspace.solver->fillRatio());
+            break;
+        }
+    }
 
-            if (type == 'V') {
-                int nodeNum = stoi(id);
-                if (nodeNum > 0 && nodeNum <= flatCircuit->nodeCount) {
-                    double magnitude = std::abs(x(nodeNum - 1));
-                    this->simulationResults[key].push_back(magnitude);
-                }
-            } else if (type == 'I') {
-                if (flatCircuit->currentComponentMap.count(id)) {
-                    int m_idx = flatCircuit->currentComponentMap.at(id);
-                    double magnitude = std::abs(x(flatCircuit->nodeCount + m_idx - 1));
-                    this->simulationResults[key].push_back(magnitude);
-                }
-            }
+    vector<double>& frequencyColumn = this->simulationResults["Frequency"];
+    frequencyColumn = frequencies;
+    for (size_t k = 0; k < columns.size(); ++k) {
+        columns[k]->reserve(frequencies.size());
+        for (size_t point = 0; point < frequencies.size(); ++point) {
+            columns[k]->push_back(magnitudes[point * rows.size() + k]);
         }
     }
     cout << "AC Sweep analysis finished." << endl;
@@ -223,6 +844,8 @@ void Circuit::runPhaseAnalysis(double baseFreq, double startPhase, double stopPh
         cout << "Circuit is empty. Cannot run analysis." << endl;
         return;
     }
+    flatCircuit->selectLinearSolver(options.acSolver);
+    flatCircuit->compileACSystem();
 
 
     ACVoltageSource* acSource = nullptr;
@@ -236,6 +859,8 @@ void Circuit::runPhaseAnalysis(double baseFreq, double startPhase, double stopPh
         throw runtime_error("Phase analysis requires at least one AC Voltage Source in the circuit.");
     }
 
+    ParameterHandle sourcePhase = acSource->parameterHandle("Phase");
+
     this->simulationResults.clear();
     this->simulationResults["Phase"];
 
@@ -243,77 +868,87 @@ void Circuit::runPhaseAnalysis(double baseFreq, double startPhase, double stopPh
 
     cout << "--- Starting Phase Sweep Analysis ---" << endl;
     double omega = 2 * M_PI * baseFreq;
+    // The frequency is fixed, so only the source phasor (the right-hand side) changes per point
+    // and the matrix is factorized once.
+    ACWorkspace workspace;
+    workspace.solver = makeLinearSolver<complex<double>>(flatCircuit->activeSolver, options.ordering);
+    flatCircuit->acSystem->factorizeAt(omega, workspace);
 
     for (int i = 0; i < numPoints; ++i) {
         double phase = startPhase + i * (stopPhase - startPhase) / (numPoints - 1);
 
 
-        acSource->setProperties({{"Phase", phase}});
-
-        MatrixXcd A = MatrixXcd::Zero(matrix_size, matrix_size);
-        VectorXcd b = VectorXcd::Zero(matrix_size);
-
-        for (const auto& comp : flatCircuit->components) {
-            int final_current_idx = -1;
-            if (comp->addsCurrentVariable()) {
-                final_current_idx = flatCircuit->nodeCount + flatCircuit->currentComponentMap.at(comp->getName()) - 1;
-            }
-            comp->stampAC(A, b, final_current_idx, omega); // از همان stampAC استفاده می‌کنیم
-        }
+        sourcePhase.set(phase);
+        flatCircuit->stampACRhs();
 
-        VectorXcd x = A.colPivHouseholderQr().solve(b);
+        workspace.solver->solveInto(flatCircuit->acSystem->rhs(), workspace.x); // از همان stampAC استفاده می‌کنیم
 
         this->simulationResults["Phase"].push_back(phase);
 
     }
+    flatCircuit->reportFillRatio(workspace.solver->fillRatio());
     cout << "Phase Sweep analysis finished." << endl;
 }
 
-void Circuit::runDCSweep(const string& sweepSourceName, double startVal, double endVal, double increment, const vector<PrintVariable>& printVars) {
-    unique_ptr<Circuit> flatCircuit = this->clone();
-    flatCircuit->analyzeCircuit();
+// The value a DC sweep drives on source, which must be a DC voltage or current source.
+static ParameterHandle sweepParameterOf(Component* source, const string& sourceName) {
+    if (!source) {
+        throw runtime_error("Sweep source '" + sourceName + "' not found.");
+    }
+    ParameterHandle parameter;
+    if (dynamic_cast<VoltageSource*>(source)) parameter = source->parameterHandle("Voltage");
+    else if (dynamic_cast<CurrentSource*>(source)) parameter = source->parameterHandle("Current");
+    if (!parameter) {
+        throw runtime_error("DC Sweep can only be performed on a DC Voltage or Current source.");
+    }
+    return parameter;
+}
 
-    Component* sweepSource = flatCircuit->findComponent(sweepSourceName);
-    if (!sweepSource) {
-        throw runtime_error("Sweep source '" + sweepSourceName + "' not found.");
+static vector<double> sweepValues(const DCSweepAxis& axis) {
+    vector<double> values;
+    for (double value = axis.start; value <= axis.end; value += axis.increment) {
+        values.push_back(value);
     }
+    return values;
+}
 
-    string propToSweep;
-    if (dynamic_cast<VoltageSource*>(sweepSource)) {
-        propToSweep = "Voltage";
-    } else if (dynamic_cast<CurrentSource*>(sweepSource)) {
-        propToSweep = "Current";
-    } else {
-        throw runtime_error("DC Sweep can only be performed on a DC Voltage or Current source.");
+// Appends the matrix row and column header of every requested variable that exists.
+void Circuit::resolvePrintRows(const vector<PrintVariable>& printVars, vector<int>& rows, vector<string>& headers) const {
+    for (const auto& var : printVars) {
+        if (toupper(var.type) == 'V') {
+            int row = nodeRowOf(stoi(var.id));
+            if (row >= 0) {
+                rows.push_back(row);
+                headers.push_back("V(" + var.id + ")");
+            }
+        } else if (toupper(var.type) == 'I') {
+            if (currentComponentMap.count(var.id)) {
+                rows.push_back(nodeCount + currentComponentMap.at(var.id) - 1);
+                headers.push_back("I(" + var.id + ")");
+            }
+        }
     }
+}
 
-    const double h_dc = 1e12;
+void Circuit::runDCSweep(const string& sweepSourceName, double startVal, double endVal, double increment, const vector<PrintVariable>& printVars) {
+    unique_ptr<Circuit> flatCircuit = this->clone();
+    flatCircuit->analyzeCircuit();
+
+    ParameterHandle sweepParameter = sweepParameterOf(flatCircuit->findComponent(sweepSourceName), sweepSourceName);
 
     int matrix_size = flatCircuit->nodeCount + flatCircuit->currentVarCount;
     if (matrix_size == 0) {
         cout << "Circuit is empty. Cannot run analysis." << endl;
         return;
     }
+    flatCircuit->selectLinearSolver(options.dcSolver);
+    flatCircuit->compileStampPlan();
+    flatCircuit->prepareNonlinearDevices();
 
     vector<int> printIndices;
     vector<string> printHeaders;
     printHeaders.push_back(sweepSourceName);
-
-    for (const auto& var : printVars) {
-        if (toupper(var.type) == 'V') {
-            int nodeNum = stoi(var.id);
-            if (nodeNum > 0 && nodeNum <= flatCircuit->nodeCount) {
-                printIndices.push_back(nodeNum - 1);
-                printHeaders.push_back("V(" + var.id + ")");
-            }
-        } else if (toupper(var.type) == 'I') {
-            if (flatCircuit->currentComponentMap.count(var.id)) {
-                int m_idx = flatCircuit->currentComponentMap.at(var.id);
-                printIndices.push_back(flatCircuit->nodeCount + m_idx - 1);
-                printHeaders.push_back("I(" + var.id + ")");
-            }
-        }
-    }
+    flatCircuit->resolvePrintRows(printVars, printIndices, printHeaders);
 
     cout << "--- Starting DC Sweep Analysis ---" << endl;
     for(const auto& header : printHeaders) {
@@ -321,32 +956,13 @@ void Circuit::runDCSweep(const string& sweepSourceName, double startVal, double
     }
     cout << endl;
 
+    // Continuation along the sweep: each point is warm-started from the previous solutions.
+    deque<pair<double, VectorXd>> history;
+    int subdivisions = 0;
     for (double sweepVal = startVal; sweepVal <= endVal; sweepVal += increment) {
-        sweepSource->setProperties({{propToSweep, sweepVal}});
-
-        VectorXd x = VectorXd::Zero(matrix_size);
-        const int MAX_NR_ITER = 100;
-        const double NR_TOLERANCE = 1e-6;
-
-        for (int i = 0; i < MAX_NR_ITER; ++i) {
-            MatrixXd A = MatrixXd::Zero(matrix_size, matrix_size);
-            VectorXd b = VectorXd::Zero(matrix_size);
-            for (const auto& comp : flatCircuit->components) {
-                int final_current_idx = -1;
-                if (comp->addsCurrentVariable()) {
-                    final_current_idx = flatCircuit->nodeCount + flatCircuit->currentComponentMap.at(comp->getName()) - 1;
-                }
-                comp->stamp(A, b, x, final_current_idx, h_dc, 0.0);
-            }
-            VectorXd x_next = A.colPivHouseholderQr().solve(b);
-            if ((x_next - x).norm() < NR_TOLERANCE) {
-                x = x_next;
-                break;
-            }
-            x = x_next;
-            if (i == MAX_NR_ITER - 1) {
-                cout << "Warning: Newton-Raphson did not converge for sweep value " << sweepVal << endl;
-            }
+        VectorXd x;
+        if (!flatCircuit->continueSweep(sweepParameter, sweepVal, history, x, subdivisions)) {
+            cout << "Warning: Newton-Raphson did not converge for sweep value " << sweepVal << endl;
         }
 
         cout << left << setw(15) << fixed << setprecision(6) << sweepVal;
@@ -355,9 +971,177 @@ void Circuit::runDCSweep(const string& sweepSourceName, double startVal, double
         }
         cout << endl;
     }
+    if (subdivisions > 0) cout << "DC sweep: " << subdivisions << " step subdivisions" << endl;
+    flatCircuit->reportNewtonStatistics();
     cout << "DC Sweep analysis finished." << endl;
 }
 
+// Two-source sweep: for every outer value the inner source runs over its whole range. The
+// outer values are split into one contiguous segment per worker; each segment solves on its
+// own clone of the flattened circuit and continues from point to point within the segment,
+// along the outer axis at the first inner value and along the inner axis from there. The
+// table is kept in simulationResults as one column per source and variable, outer-major.
+void Circuit::runNestedDCSweep(const DCSweepAxis& outer, const DCSweepAxis& inner, const vector<PrintVariable>& printVars) {
+    unique_ptr<Circuit> flatCircuit = this->clone();
+    flatCircuit->analyzeCircuit();
+    sweepParameterOf(flatCircuit->findComponent(outer.source), outer.source);
+    sweepParameterOf(flatCircuit->findComponent(inner.source), inner.source);
+    if (outer.source == inner.source) {
+        throw runtime_error("A nested DC sweep needs two different sources.");
+    }
+
+    int matrix_size = flatCircuit->nodeCount + flatCircuit->currentVarCount;
+    if (matrix_size == 0) {
+        cout << "Circuit is empty. Cannot run analysis." << endl;
+        return;
+    }
+    flatCircuit->selectLinearSolver(options.dcSolver);
+
+    vector<int> printIndices;
+    vector<string> printHeaders = {outer.source, inner.source};
+    flatCircuit->resolvePrintRows(printVars, printIndices, printHeaders);
+
+    const vector<double> outerValues = sweepValues(outer);
+    const vector<double> innerValues = sweepValues(inner);
+    if (outerValues.empty() || innerValues.empty()) {
+        cout << "DC sweep range is empty." << endl;
+        return;
+    }
+
+    // Worker circuits are compiled up front on this thread; the solver choice is shared.
+    unsigned threads = resolveThreadCount(options.threads, outerValues.size());
+    vector<unique_ptr<Circuit>> segments;
+    for (unsigned k = 0; k < threads; ++k) {
+        unique_ptr<Circuit> segment = flatCircuit->clone();
+        segment->analyzeCircuit();
+        segment->activeSolver = flatCircuit->activeSolver;
+        segment->fillReported = true;
+        segment->compileStampPlan();
+        segment->prepareNonlinearDevices();
+        segments.push_back(move(segment));
+    }
+    cout << "--- Starting Nested DC Sweep Analysis ---" << endl;
+    cout << "DC sweep: " << outerValues.size() << " x " << innerValues.size() << " points in " << threads << " segment(s)" << endl;
+
+    const size_t columns = printIndices.size();
+    vector<double> table(outerValues.size() * innerValues.size() * columns);
+    vector<char> converged(outerValues.size() * innerValues.size(), 1);
+    vector<int> subdivisions(threads, 0);
+    parallelFor(threads, threads, [&](unsigned /*worker*/, size_t k) {
+        Circuit& segment = *segments[k];
+        const ParameterHandle outerParameter = sweepParameterOf(segment.findComponent(outer.source), outer.source);
+        const ParameterHandle innerParameter = sweepParameterOf(segment.findComponent(inner.source), inner.source);
+        const size_t first = outerValues.size() * k / threads;
+        const size_t last = outerValues.size() * (k + 1) / threads;
+
+        deque<pair<double, VectorXd>> outerHistory;
+        for (size_t i = first; i < last; ++i) {
+            deque<pair<double, VectorXd>> innerHistory;
+            for (size_t j = 0; j < innerValues.size(); ++j) {
+                VectorXd x;
+                bool ok;
+                if (j == 0) {
+                    innerParameter.set(innerValues[0]);
+                    ok = segment.continueSweep(outerParameter, outerValues[i], outerHistory, x, subdivisions[k]);
+                    if (ok) innerHistory.emplace_back(innerValues[0], x);
+                } else {
+                    ok = segment.continueSweep(innerParameter, innerValues[j], innerHistory, x, subdivisions[k]);
+                }
+                const size_t point = i * innerValues.size() + j;
+                converged[point] = ok;
+                for (size_t c = 0; c < columns; ++c) table[point * columns + c] = x(printIndices[c]);
+            }
+        }
+    });
+
+    this->simulationResults.clear();
+    vector<vector<double>*> resultColumns;
+    for (const auto& header : printHeaders) {
+        resultColumns.push_back(&this->simulationResults[header]);
+        resultColumns.back()->reserve(table.size() / max<size_t>(columns, 1));
+    }
+    for (const auto& header : printHeaders) {
+        cout << left << setw(15) << header;
+    }
+    cout << endl;
+    for (size_t i = 0; i < outerValues.size(); ++i) {
+        for (size_t j = 0; j < innerValues.size(); ++j) {
+            const size_t point = i * innerValues.size() + j;
+            if (!converged[point]) {
+                cout << "Warning: Newton-Raphson did not converge for sweep values " << outerValues[i] << ", " << innerValues[j] << endl;
+            }
+            resultColumns[0]->push_back(outerValues[i]);
+            resultColumns[1]->push_back(innerValues[j]);
+            cout << left << setw(15) << fixed << setprecision(6) << outerValues[i] << setw(15) << innerValues[j];
+            for (size_t c = 0; c < columns; ++c) {
+                resultColumns[c + 2]->push_back(table[point * columns + c]);
+                cout << setw(15) << table[point * columns + c];
+            }
+            cout << endl;
+        }
+    }
+
+    int totalSubdivisions = 0;
+    for (size_t k = 0; k < segments.size(); ++k) {
+        totalSubdivisions += subdivisions[k];
+        flatCircuit->newtonIterations += segments[k]->newtonIterations;
+        flatCircuit->newtonSolves += segments[k]->newtonSolves;
+        auto [evaluations, bypassed] = segments[k]->deviceBypassCounts();
+        flatCircuit->mergedEvaluations += evaluations;
+        flatCircuit->mergedBypasses += bypassed;
+    }
+    if (totalSubdivisions > 0) cout << "DC sweep: " << totalSubdivisions << " step subdivisions" << endl;
+    flatCircuit->reportNewtonStatistics();
+    cout << "Nested DC Sweep analysis finished." << endl;
+}
+
+void Circuit::runOperatingPoint(const vector<PrintVariable>& printVars) {
+    unique_ptr<Circuit> flatCircuit = this->clone();
+    flatCircuit->analyzeCircuit();
+
+    int matrix_size = flatCircuit->nodeCount + flatCircuit->currentVarCount;
+    if (matrix_size == 0) {
+        cout << "Circuit is empty. Cannot run analysis." << endl;
+        return;
+    }
+    flatCircuit->selectLinearSolver(options.dcSolver);
+    flatCircuit->compileStampPlan();
+    flatCircuit->prepareNonlinearDevices();
+
+    cout << "--- Starting DC Operating Point Analysis ---" << endl;
+    VectorXd x = VectorXd::Zero(matrix_size);
+    if (!flatCircuit->solveOperatingPoint(x, 0.0)) {
+        throw runtime_error("DC operating point did not converge.");
+    }
+
+    // Every node voltage and branch current, or only the requested ones; each is kept as a
+    // one-point result column.
+    this->simulationResults.clear();
+    if (printVars.empty()) {
+        for (int i = 0; i < flatCircuit->nodeCount; ++i) {
+            this->simulationResults["V(" + to_string(flatCircuit->nodeIds[i]) + ")"] = {x(i)};
+        }
+        for (const auto& pair : flatCircuit->currentComponentMap) {
+            this->simulationResults["I(" + pair.first + ")"] = {x(flatCircuit->nodeCount + pair.second - 1)};
+        }
+    } else {
+        for (const auto& var : printVars) {
+            if (toupper(var.type) == 'V') {
+                int row = flatCircuit->nodeRowOf(stoi(var.id));
+                if (row >= 0) this->simulationResults["V(" + var.id + ")"] = {x(row)};
+            } else if (toupper(var.type) == 'I' && flatCircuit->currentComponentMap.count(var.id)) {
+                this->simulationResults["I(" + var.id + ")"] = {x(flatCircuit->nodeCount + flatCircuit->currentComponentMap.at(var.id) - 1)};
+            }
+        }
+    }
+    for (const auto& [key, val] : this->simulationResults) {
+        cout << left << setw(15) << key << scientific << setprecision(6) << val.front() << endl;
+    }
+    cout.unsetf(ios::floatfield);
+    flatCircuit->reportNewtonStatistics();
+    cout << "DC operating point analysis finished." << endl;
+}
+
 void Circuit::checkConnectivity() const {
     if (components.empty()) {
         return;
@@ -461,6 +1245,8 @@ void Circuit::clear() {
     wires.clear();
     m_externalPorts.clear();
     currentComponentMap.clear();
+    branchRows.clear();
+    reactiveState.clear();
     simulationResults.clear();
     nodeCount = 0;
     currentVarCount = 0;
@@ -492,22 +1278,38 @@ void Circuit::renameNode(int oldNode, int newNode) {
     }
 }
 
+int Circuit::nodeRowOf(int nodeId) const {
+    auto it = nodeRows.find(nodeId);
+    return (it != nodeRows.end()) ? it->second : -1;
+}
+
 void Circuit::analyzeCircuit() {
     flattenCircuit();
 
-    set<int> final_nodes;
+    // Node ids come from the netlist, the schematic or subcircuit offsets and can have large
+    // gaps, so the used ids are packed into contiguous matrix rows.
+    nodeIds.clear();
+    nodeRows.clear();
+    map<int, int> compactIds = {{0, 0}};
+    for (int node : getNodes()) {
+        if (node <= 0) continue;
+        nodeIds.push_back(node);
+        nodeRows[node] = static_cast<int>(nodeIds.size()) - 1;
+        compactIds[node] = static_cast<int>(nodeIds.size());
+    }
+    nodeCount = static_cast<int>(nodeIds.size());
+
     currentVarCount = 0;
     currentComponentMap.clear();
-    for (const auto& comp : components) {
-        for (int node : comp->getNodes()) {
-            final_nodes.insert(node);
-        }
-        if (comp->addsCurrentVariable()) {
+    branchRows.assign(components.size(), -1);
+    for (size_t i = 0; i < components.size(); ++i) {
+        components[i]->remapNodes(compactIds);
+        if (components[i]->addsCurrentVariable()) {
             currentVarCount++;
-            currentComponentMap[comp->getName()] = currentVarCount;
+            currentComponentMap[components[i]->getName()] = currentVarCount;
+            branchRows[i] = nodeCount + currentVarCount - 1;
         }
     }
-    nodeCount = final_nodes.empty() ? 0 : *final_nodes.rbegin();
 
     for (auto& comp : components) {
         string ctrlName = comp->getCtrlVName();
@@ -521,6 +1323,11 @@ void Circuit::analyzeCircuit() {
         }
     }
 
+    reactiveState.clear();
+    for (size_t i = 0; i < components.size(); ++i) {
+        if (components[i]->isReactive()) components[i]->bindReactiveState(reactiveState, branchRows[i]);
+    }
+
     checkConnectivity();
 }
 
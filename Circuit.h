@@ -6,10 +6,17 @@
 #include <string>
 #include <map>
 #include <set>
+#include <deque>
 #include <Eigen/Dense>
 #include "Component.h"
 #include "PrintRequest.h"
 #include "WireInfo.h"
+#include "LinearSolver.h"
+#include "SimulationOptions.h"
+#include "StampPlan.h"
+#include "DeviceGroups.h"
+#include "ACSystem.h"
+#include "ResultStore.h"
 
 // اضافه کردن هدرهای لازم برای سریال‌سازی
 #include <cereal/cereal.hpp>
@@ -19,6 +26,27 @@
 using namespace std;
 using namespace Eigen;
 
+// One source of a DC sweep and the values it runs over: start, start + increment, ... <= end.
+struct DCSweepAxis {
+    string source;
+    double start = 0.0;
+    double end = 0.0;
+    double increment = 1.0;
+};
+
+// Scratch of the Newton and time-point solves, sized once per analysis by compileStampPlan and
+// reused by every iteration: a solver that keeps its storage (and, for sparse LU, its symbolic
+// analysis, since the stamp plan fixes the pattern), the right-hand side and the next iterate.
+struct NewtonWorkspace {
+    unique_ptr<LinearSolver<double>> solver;
+    bool analyzed = false;
+    VectorXd b;
+    VectorXd x_next;
+    // Zero vectors for stamp passes that only need the matrix.
+    VectorXd unusedRhs;
+    VectorXd x_zero;
+};
+
 struct TheveninEquivalent {
     double Vth = 0.0;
     double Rth = 0.0;
@@ -37,11 +65,16 @@ public:
     void runACAnalysis(double startFreq, double stopFreq, int numPoints, const string& sweepType, const vector<PrintVariable>& printVars = {});
     void runPhaseAnalysis(double baseFreq, double startPhase, double stopPhase, int numPoints, const vector<PrintVariable>& printVars = {});
     void runDCSweep(const string& sweepSourceName, double startVal, double endVal, double increment, const vector<PrintVariable>& printVars);
+    // Sweeps inner over its range for every value of outer, in parallel segments of the outer axis.
+    void runNestedDCSweep(const DCSweepAxis& outer, const DCSweepAxis& inner, const vector<PrintVariable>& printVars);
+    void runOperatingPoint(const vector<PrintVariable>& printVars = {});
     void clear();
     TheveninEquivalent calculateTheveninEquivalent(int port1_node, int port2_node);
 
     set<int> getNodes() const;
     int getNodeCount() const { return nodeCount; }
+    // After analyzeCircuit: the matrix row of a netlist node id, or -1 for ground and unused ids.
+    int nodeRowOf(int nodeId) const;
     int getCurrentVarCount() const { return currentVarCount; }
 
     void renameNode(int oldNode, int newNode);
@@ -59,6 +92,10 @@ public:
 
     void analyzeCircuit();
 
+    SimulationOptions& getOptions() { return options; }
+    const SimulationOptions& getOptions() const { return options; }
+    void setOptions(const SimulationOptions& newOptions) { options = newOptions; }
+
     // --- تابع جدید اضافه شده برای سریال‌سازی ---
     template<class Archive>
     void serialize(Archive & ar) {
@@ -71,12 +108,101 @@ private:
     vector<int> m_externalPorts;
 
     map<string, int> currentComponentMap;
+    // Set by analyzeCircuit: branchRows[i] is the matrix row of component i's branch current,
+    // or -1 if it adds none, so stamping never looks a name up in currentComponentMap.
+    vector<int> branchRows;
+    // analyzeCircuit renumbers the used node ids to 1..nodeCount; nodeIds[row] is the netlist
+    // id of matrix row `row` and nodeRows the inverse, used to name results V(n).
+    vector<int> nodeIds;
+    map<int, int> nodeRows;
     int nodeCount = 0;
     int currentVarCount = 0;
-    map<string, vector<double>> simulationResults;
+    ResultStore simulationResults;
+    SimulationOptions options;
+    LinearSolverType activeSolver = LinearSolverType::DenseLU;
+    bool fillReported = false;
+    unique_ptr<StampPlan> stampPlan;
+    // Static/dynamic split of the plan values: staticValues holds the h-independent linear
+    // stamps, linearValues adds the companion models for companionKey, and linearRhs holds
+    // the right-hand side of all linear components at the current time point.
+    vector<double> staticValues;
+    vector<double> linearValues;
+    // {-1, 0} until companion values are stamped; real keys have h >= 0.
+    pair<double, double> companionKey{-1.0, 0.0};
+    // Capacitor and inductor integration history, one slot per device, bound by analyzeCircuit.
+    // Components point into it, so a circuit stays where it was analysed.
+    ReactiveState reactiveState;
+    // Batched view of the resistors, VCCSs, capacitors, inductors and diodes, built with the stamp
+    // plan; grouped[i] marks the components it stamps in place of their stamp().
+    DeviceGroups deviceGroups;
+    vector<char> grouped;
+    VectorXd linearRhs;
+    NewtonWorkspace newton;
+    unique_ptr<ACSystem> acSystem;
+    // Newton statistics of the analysis run on this (flattened) circuit.
+    long newtonIterations = 0;
+    long newtonSolves = 0;
+    // Device evaluations and bypasses merged in from the segment circuits of a parallel sweep.
+    long mergedEvaluations = 0;
+    long mergedBypasses = 0;
+    // Operating point homotopy state: a conductance from every node to ground, and the factor
+    // the linear right-hand side (at DC only the independent sources) is scaled by.
+    double gmin = 0.0;
+    double sourceScale = 1.0;
+    // Passed as the step h, selects the DC stamps: capacitors open and inductors as 0 V branches.
+    static constexpr double DC_MODE = 0.0;
+    // Accepted points kept for the predictor and the truncation error estimate: enough for a
+    // quadratic predictor and the third divided difference of a second-order method.
+    static constexpr size_t HISTORY_LENGTH = 3;
 
     void flattenCircuit();
     void checkConnectivity() const;
+    // Resolves the requested backend (auto picks from size and fill) for the analysis about to run.
+    void selectLinearSolver(LinearSolverType requested);
+    void reportFillRatio(double ratio);
+    void recordStamps(vector<Triplet<double>>& recorded, vector<int>& componentBegin);
+    // Analysis-time compile step: maps every stamp write to its slot in the matrix storage.
+    void compileStampPlan();
+    void stampComponent(size_t index, VectorXd& b, const VectorXd& x_guess, double h, double t);
+    pair<double, double> companionKeyFor(double h) const;
+    void updateCompanionValues(double h);
+    // Stamps everything that does not depend on the Newton guess; call once per time point.
+    void stampLinearPart(const VectorXd& x_guess, double h, double t);
+    // Re-adds only the nonlinear device stamps on top of the linear part and solves.
+    // Solves one Newton iteration into newton.x_next.
+    void solveNewtonIteration(const VectorXd& x_guess, double h, double t);
+    VectorXd solveSystem(const VectorXd& x_guess, double h, double t);
+    void compileACSystem();
+    void stampACRhs();
+    // The solution is workspace.x, valid until the next call with the same workspace.
+    const VectorXcd& solveACSystem(double omega, ACWorkspace& workspace) const;
+    unique_ptr<LinearSolver<double>> factorizeLinearSystem(double h);
+    void solveFactorized(const LinearSolver<double>& solver, const VectorXd& x_guess, double h, double t, VectorXd& x);
+    // Linear transient factorizations keyed like companionKey.
+    using FactorizationCache = map<pair<double, double>, unique_ptr<LinearSolver<double>>>;
+    bool solveTimePoint(const VectorXd& x_start, double h, double t, bool hasNonLinear, FactorizationCache& factorizations, VectorXd& x);
+    bool solveNewton(VectorXd& x, double h, double t);
+    void stampGmin();
+    // DC solution at time t from the guess in x, falling back to gmin and then source stepping.
+    bool solveOperatingPoint(VectorXd& x, double t);
+    // DC sweep continuation: solves the sweep point at `value` from the solutions in history
+    // (sweep value, x), subdividing the step on failure; appends every converged point.
+    bool continueSweep(const ParameterHandle& parameter, double value, deque<pair<double, VectorXd>>& history, VectorXd& x, int& subdivisions);
+    void resolvePrintRows(const vector<PrintVariable>& printVars, vector<int>& rows, vector<string>& headers) const;
+    bool junctionLimited() const;
+    bool newtonConverged(const VectorXd& x_new, const VectorXd& x_old) const;
+    void prepareNonlinearDevices();
+    void reportNewtonStatistics() const;
+    // Nonlinear device evaluations and bypassed ones on this circuit, as {evaluations, bypassed}.
+    pair<long, long> deviceBypassCounts() const;
+    void applyIntegrationMethod(IntegrationMethod method);
+    void restartIntegration();
+    double nextBreakpoint(double t) const;
+    double maxSourceStep() const;
+    void acceptTimePoint(const VectorXd& x, double h);
+    void registerTransientResults(ResultStore& results) const;
+    void predictSolution(const deque<pair<double, VectorXd>>& history, double t_new, VectorXd& guess) const;
+    double truncationErrorRatio(const deque<pair<double, VectorXd>>& history, double t_new, const VectorXd& x_new) const;
 };
 
 #endif
@@ -28,7 +28,7 @@ void Circuit::loadFromFile(const std::string& filepath) {
 }
 
 const map<string, vector<double>>& Circuit::getSimulationResults() const {
-    return simulationResults;
+    return simulationResults.byName();
 }
 
 
@@ -43,22 +43,15 @@ TheveninEquivalent Circuit::calculateTheveninEquivalent(int port1_node, int port
         int matrix_size = vth_circuit->getNodeCount() + vth_circuit->getCurrentVarCount();
         if (matrix_size == 0) return result;
 
-        MatrixXd A = MatrixXd::Zero(matrix_size, matrix_size);
-        VectorXd b = VectorXd::Zero(matrix_size);
+        vth_circuit->selectLinearSolver(options.dcSolver);
+        vth_circuit->compileStampPlan();
         VectorXd x_guess = VectorXd::Zero(matrix_size); // برای DC guess اولیه صفر است
+        VectorXd x = vth_circuit->solveSystem(x_guess, DC_MODE, 0.0);
 
-        for (const auto& comp : vth_circuit->getComponents()) {
-            int current_idx = -1;
-            if (comp->addsCurrentVariable()) {
-                current_idx = vth_circuit->getNodeCount() + vth_circuit->currentComponentMap.at(comp->getName()) - 1;
-            }
-            comp->stamp(A, b, x_guess, current_idx, 1e12, 0.0);
-        }
-
-        VectorXd x = A.colPivHouseholderQr().solve(b);
-
-        double v1 = (port1_node > 0) ? x(port1_node - 1) : 0.0;
-        double v2 = (port2_node > 0) ? x(port2_node - 1) : 0.0;
+        int row1 = vth_circuit->nodeRowOf(port1_node);
+        int row2 = vth_circuit->nodeRowOf(port2_node);
+        double v1 = (row1 >= 0) ? x(row1) : 0.0;
+        double v2 = (row2 >= 0) ? x(row2) : 0.0;
         result.Vth = v1 - v2;
     }
 
@@ -67,7 +60,9 @@ TheveninEquivalent Circuit::calculateTheveninEquivalent(int port1_node, int port
 
         for (const auto& comp_ptr : rth_circuit->getComponents()) {
             if (dynamic_cast<VoltageSource*>(comp_ptr.get()) || dynamic_cast<CurrentSource*>(comp_ptr.get())) {
-                comp_ptr->setProperties({{"Voltage", 0.0}, {"Current", 0.0}});
+                for (const char* property : {"Voltage", "Current"}) {
+                    if (ParameterHandle source = comp_ptr->parameterHandle(property)) source.set(0.0);
+                }
             }
         }
 
@@ -75,22 +70,15 @@ TheveninEquivalent Circuit::calculateTheveninEquivalent(int port1_node, int port
         rth_circuit->analyzeCircuit();
 
         int matrix_size = rth_circuit->getNodeCount() + rth_circuit->getCurrentVarCount();
-        MatrixXd A = MatrixXd::Zero(matrix_size, matrix_size);
-        VectorXd b = VectorXd::Zero(matrix_size);
+        rth_circuit->selectLinearSolver(options.dcSolver);
+        rth_circuit->compileStampPlan();
         VectorXd x_guess = VectorXd::Zero(matrix_size);
+        VectorXd x = rth_circuit->solveSystem(x_guess, DC_MODE, 0.0);
 
-        for (const auto& comp : rth_circuit->getComponents()) {
-            int current_idx = -1;
-            if (comp->addsCurrentVariable()) {
-                current_idx = rth_circuit->getNodeCount() + rth_circuit->currentComponentMap.at(comp->getName()) - 1;
-            }
-            comp->stamp(A, b, x_guess, current_idx, 1e12, 0.0);
-        }
-
-        VectorXd x = A.colPivHouseholderQr().solve(b);
-
-        double v1 = (port1_node > 0) ? x(port1_node - 1) : 0.0;
-        double v2 = (port2_node > 0) ? x(port2_node - 1) : 0.0;
+        int row1 = rth_circuit->nodeRowOf(port1_node);
+        int row2 = rth_circuit->nodeRowOf(port2_node);
+        double v1 = (row1 >= 0) ? x(row1) : 0.0;
+        double v2 = (row2 >= 0) ? x(row2) : 0.0;
         result.Rth = v1 - v2;
     }
 
@@ -41,100 +41,129 @@ void Component::updateNode(int oldNode, int newNode) {
     if (auto vccs = dynamic_cast<VCCS*>(this)) { vccs->updateCtrlNodes(oldNode, newNode); }
 }
 
+static int remappedNode(const map<int, int>& nodeMap, int node) {
+    auto it = nodeMap.find(node);
+    return (it != nodeMap.end()) ? it->second : node;
+}
+
+void Component::remapNodes(const map<int, int>& nodeMap) {
+    for (int& node : nodes) {
+        node = remappedNode(nodeMap, node);
+    }
+    if (auto vcvs = dynamic_cast<VCVS*>(this)) { vcvs->remapCtrlNodes(nodeMap); }
+    if (auto vccs = dynamic_cast<VCCS*>(this)) { vccs->remapCtrlNodes(nodeMap); }
+}
+
 // --- Resistor ---
 Resistor::Resistor(const string& name, int n1, int n2, double res) : Component(name, {n1, n2}), resistance(res) {}
 void Resistor::setProperties(const map<string, double>& properties) { if (properties.count("Resistance")) resistance = properties.at("Resistance"); }
+ParameterHandle Resistor::parameterHandle(const string& property) { return property == "Resistance" ? ParameterHandle(&resistance) : ParameterHandle(); }
 map<string, double> Resistor::getProperties() const { return {{"Resistance", resistance}}; }
 string Resistor::getDisplayValue() const { return formatValue(resistance) + "Ohm"; }
 void Resistor::print() const { cout << "Type: Resistor, Name: " << name << ", Nodes: (" << getNode(0) << "," << getNode(1) << "), R=" << resistance << " Ohms" << endl; }
 string Resistor::toNetlistString() const { return name + " " + to_string(getNode(0)) + " " + to_string(getNode(1)) + " " + to_string(resistance); }
-void Resistor::stamp(MatrixXd& A, VectorXd& b, const VectorXd& x_prev_nr, int current_idx, double h, double t) {
+void Resistor::stamp(RealStamper& A, VectorXd& b, const VectorXd& x_prev_nr, int current_idx, double h, double t) {
     double g = 1.0 / resistance;
     int n1 = getNode(0) - 1;
     int n2 = getNode(1) - 1;
-    if (n1 >= 0) A(n1, n1) += g;
-    if (n2 >= 0) A(n2, n2) += g;
-    if (n1 >= 0 && n2 >= 0) { A(n1, n2) -= g; A(n2, n1) -= g; }
+    if (n1 >= 0) A.add(n1, n1, g);
+    if (n2 >= 0) A.add(n2, n2, g);
+    if (n1 >= 0 && n2 >= 0) { A.add(n1, n2, -g); A.add(n2, n1, -g); }
 }
-void Resistor::stampAC(MatrixXcd& A, VectorXcd& b, int current_idx, double omega) const {
+void Resistor::stampAC(ComplexStamper& A, VectorXcd& b, int current_idx, double omega) const {
     double g = 1.0 / resistance;
     int n1 = getNode(0) - 1;
     int n2 = getNode(1) - 1;
-    if (n1 >= 0) A(n1, n1) += g;
-    if (n2 >= 0) A(n2, n2) += g;
-    if (n1 >= 0 && n2 >= 0) { A(n1, n2) -= g; A(n2, n1) -= g; }
+    if (n1 >= 0) A.add(n1, n1, g);
+    if (n2 >= 0) A.add(n2, n2, g);
+    if (n1 >= 0 && n2 >= 0) { A.add(n1, n2, -g); A.add(n2, n1, -g); }
 }
 
 // --- Capacitor ---
-Capacitor::Capacitor(const string& name, int n1, int n2, double cap) : Component(name, {n1, n2}), capacitance(cap), prev_voltage(0.0) {}
+Capacitor::Capacitor(const string& name, int n1, int n2, double cap) : Component(name, {n1, n2}), capacitance(cap) {}
 void Capacitor::setProperties(const map<string, double>& properties) { if (properties.count("Capacitance")) capacitance = properties.at("Capacitance"); }
+ParameterHandle Capacitor::parameterHandle(const string& property) { return property == "Capacitance" ? ParameterHandle(&capacitance) : ParameterHandle(); }
 map<string, double> Capacitor::getProperties() const { return {{"Capacitance", capacitance}}; }
 string Capacitor::getDisplayValue() const { return formatValue(capacitance) + "F"; }
 void Capacitor::print() const { cout << "Type: Capacitor, Name: " << name << ", Nodes: (" << getNode(0) << "," << getNode(1) << "), C=" << capacitance << " F" << endl; }
 string Capacitor::toNetlistString() const { return name + " " + to_string(getNode(0)) + " " + to_string(getNode(1)) + " " + to_string(capacitance); }
-void Capacitor::stamp(MatrixXd& A, VectorXd& b, const VectorXd& x_prev_nr, int current_idx, double h, double t) {
-    double g_eq = capacitance / h;
-    double I_eq = g_eq * prev_voltage;
+void Capacitor::bindReactiveState(ReactiveState& state, int branchRow) {
+    history = &state;
+    slot = state.add(capacitance, getNode(0) - 1, getNode(1) - 1, false);
+}
+// Capacitor current i = g_eq * v - I_eq for the analysis' companion model.
+void Capacitor::stamp(RealStamper& A, VectorXd& b, const VectorXd& x_prev_nr, int current_idx, double h, double t) {
+    double g_eq = h > 0 ? capacitance / h : 0.0, I_eq = 0.0;
+    if (history) history->companion(slot, h, g_eq, I_eq);
     int n1 = getNode(0) - 1;
     int n2 = getNode(1) - 1;
-    if (n1 >= 0) A(n1, n1) += g_eq;
-    if (n2 >= 0) A(n2, n2) += g_eq;
-    if (n1 >= 0 && n2 >= 0) { A(n1, n2) -= g_eq; A(n2, n1) -= g_eq; }
+    if (n1 >= 0) A.add(n1, n1, g_eq);
+    if (n2 >= 0) A.add(n2, n2, g_eq);
+    if (n1 >= 0 && n2 >= 0) { A.add(n1, n2, -g_eq); A.add(n2, n1, -g_eq); }
     if (n1 >= 0) b(n1) += I_eq;
     if (n2 >= 0) b(n2) -= I_eq;
 }
-void Capacitor::stampAC(MatrixXcd& A, VectorXcd& b, int current_idx, double omega) const {
+void Capacitor::stampAC(ComplexStamper& A, VectorXcd& b, int current_idx, double omega) const {
     complex<double> admittance = j * omega * capacitance;
     int n1 = getNode(0) - 1;
     int n2 = getNode(1) - 1;
-    if (n1 >= 0) A(n1, n1) += admittance;
-    if (n2 >= 0) A(n2, n2) += admittance;
-    if (n1 >= 0 && n2 >= 0) { A(n1, n2) -= admittance; A(n2, n1) -= admittance; }
+    if (n1 >= 0) A.add(n1, n1, admittance);
+    if (n2 >= 0) A.add(n2, n2, admittance);
+    if (n1 >= 0 && n2 >= 0) { A.add(n1, n2, -admittance); A.add(n2, n1, -admittance); }
 }
 
 // --- Inductor ---
-Inductor::Inductor(const string& name, int n1, int n2, double ind) : Component(name, {n1, n2}), inductance(ind), prev_current(0.0) {}
+Inductor::Inductor(const string& name, int n1, int n2, double ind) : Component(name, {n1, n2}), inductance(ind) {}
 void Inductor::setProperties(const map<string, double>& properties) { if (properties.count("Inductance")) inductance = properties.at("Inductance"); }
+ParameterHandle Inductor::parameterHandle(const string& property) { return property == "Inductance" ? ParameterHandle(&inductance) : ParameterHandle(); }
 map<string, double> Inductor::getProperties() const { return {{"Inductance", inductance}}; }
 string Inductor::getDisplayValue() const { return formatValue(inductance) + "H"; }
 void Inductor::print() const { cout << "Type: Inductor, Name: " << name << ", Nodes: (" << getNode(0) << "," << getNode(1) << "), L=" << inductance << " H" << endl; }
 string Inductor::toNetlistString() const { return name + " " + to_string(getNode(0)) + " " + to_string(getNode(1)) + " " + to_string(inductance); }
-void Inductor::stamp(MatrixXd& A, VectorXd& b, const VectorXd& x_prev_nr, int current_idx, double h, double t) {
+void Inductor::bindReactiveState(ReactiveState& state, int branchRow) {
+    history = &state;
+    slot = state.add(inductance, branchRow, -1, true);
+}
+// Branch equation v - R_eq * i = V_eq; the history gives v = R_eq * i - I_eq.
+void Inductor::stamp(RealStamper& A, VectorXd& b, const VectorXd& x_prev_nr, int current_idx, double h, double t) {
     int n1 = getNode(0) - 1;
     int n2 = getNode(1) - 1;
-    double R_eq = inductance / h;
-    if (n1 >= 0) A(current_idx, n1) = 1.0;
-    if (n2 >= 0) A(current_idx, n2) = -1.0;
-    A(current_idx, current_idx) = -R_eq;
-    b(current_idx) = -R_eq * prev_current;
-    if (n1 >= 0) A(n1, current_idx) = 1.0;
-    if (n2 >= 0) A(n2, current_idx) = -1.0;
-}
-void Inductor::stampAC(MatrixXcd& A, VectorXcd& b, int current_idx, double omega) const {
+    double R_eq = h > 0 ? inductance / h : 0.0, I_eq = 0.0;
+    if (history) history->companion(slot, h, R_eq, I_eq);
+    double V_eq = -I_eq;
+    if (n1 >= 0) A.add(current_idx, n1, 1.0);
+    if (n2 >= 0) A.add(current_idx, n2, -1.0);
+    A.add(current_idx, current_idx, -R_eq);
+    b(current_idx) = V_eq;
+    if (n1 >= 0) A.add(n1, current_idx, 1.0);
+    if (n2 >= 0) A.add(n2, current_idx, -1.0);
+}
+void Inductor::stampAC(ComplexStamper& A, VectorXcd& b, int current_idx, double omega) const {
     complex<double> impedance = j * omega * inductance;
     int n1 = getNode(0) - 1;
     int n2 = getNode(1) - 1;
-    if (n1 >= 0) A(current_idx, n1) = 1.0;
-    if (n2 >= 0) A(current_idx, n2) = -1.0;
-    A(current_idx, current_idx) = -impedance;
-    if (n1 >= 0) A(n1, current_idx) = 1.0;
-    if (n2 >= 0) A(n2, current_idx) = -1.0;
+    if (n1 >= 0) A.add(current_idx, n1, 1.0);
+    if (n2 >= 0) A.add(current_idx, n2, -1.0);
+    A.add(current_idx, current_idx, -impedance);
+    if (n1 >= 0) A.add(n1, current_idx, 1.0);
+    if (n2 >= 0) A.add(n2, current_idx, -1.0);
 }
 
 // --- CurrentSource ---
 CurrentSource::CurrentSource(const string& name, int n1, int n2, double current) : Component(name, {n1, n2}), current(current) {}
 void CurrentSource::setProperties(const map<string, double>& properties) { if (properties.count("Current")) current = properties.at("Current"); }
+ParameterHandle CurrentSource::parameterHandle(const string& property) { return property == "Current" ? ParameterHandle(&current) : ParameterHandle(); }
 map<string, double> CurrentSource::getProperties() const { return {{"Current", current}}; }
 string CurrentSource::getDisplayValue() const { return formatValue(current) + "A"; }
 void CurrentSource::print() const { cout << "Type: Current Source, Name: " << name << ", Nodes: (" << getNode(0) << " -> " << getNode(1) << "), I=" << current << " A" << endl; }
 string CurrentSource::toNetlistString() const { return name + " " + to_string(getNode(0)) + " " + to_string(getNode(1)) + " " + to_string(current); }
-void CurrentSource::stamp(MatrixXd& A, VectorXd& b, const VectorXd& x_prev_nr, int current_idx, double h, double t) {
+void CurrentSource::stamp(RealStamper& A, VectorXd& b, const VectorXd& x_prev_nr, int current_idx, double h, double t) {
     int n1 = getNode(0) - 1;
     int n2 = getNode(1) - 1;
     if (n1 >= 0) b(n1) += current;
     if (n2 >= 0) b(n2) -= current;
 }
-void CurrentSource::stampAC(MatrixXcd& A, VectorXcd& b, int current_idx, double omega) const {
+void CurrentSource::stampAC(ComplexStamper& A, VectorXcd& b, int current_idx, double omega) const {
     int n1 = getNode(0) - 1;
     int n2 = getNode(1) - 1;
     if (n1 >= 0) b(n1) += current;
@@ -144,27 +173,28 @@ void CurrentSource::stampAC(MatrixXcd& A, VectorXcd& b, int current_idx, double
 // --- VoltageSource ---
 VoltageSource::VoltageSource(const string& name, int n1, int n2, double vol) : Component(name, {n1, n2}), voltage(vol) {}
 void VoltageSource::setProperties(const map<string, double>& properties) { if (properties.count("Voltage")) voltage = properties.at("Voltage"); }
+ParameterHandle VoltageSource::parameterHandle(const string& property) { return property == "Voltage" ? ParameterHandle(&voltage) : ParameterHandle(); }
 map<string, double> VoltageSource::getProperties() const { return {{"Voltage", voltage}}; }
 string VoltageSource::getDisplayValue() const { return formatValue(voltage) + "V"; }
 void VoltageSource::print() const { cout << "Type: DC Source, Name: " << name << ", Nodes: (" << getNode(0) << "," << getNode(1) << "), V=" << voltage << " V" << endl; }
 string VoltageSource::toNetlistString() const { return name + " " + to_string(getNode(0)) + " " + to_string(getNode(1)) + " " + to_string(voltage); }
-void VoltageSource::stamp(MatrixXd& A, VectorXd& b, const VectorXd& x_prev_nr, int current_idx, double h, double t) {
+void VoltageSource::stamp(RealStamper& A, VectorXd& b, const VectorXd& x_prev_nr, int current_idx, double h, double t) {
     int n1 = getNode(0) - 1;
     int n2 = getNode(1) - 1;
-    if (n1 >= 0) A(current_idx, n1) = 1.0;
-    if (n2 >= 0) A(current_idx, n2) = -1.0;
+    if (n1 >= 0) A.add(current_idx, n1, 1.0);
+    if (n2 >= 0) A.add(current_idx, n2, -1.0);
     b(current_idx) = this->voltage;
-    if (n1 >= 0) A(n1, current_idx) = 1.0;
-    if (n2 >= 0) A(n2, current_idx) = -1.0;
+    if (n1 >= 0) A.add(n1, current_idx, 1.0);
+    if (n2 >= 0) A.add(n2, current_idx, -1.0);
 }
-void VoltageSource::stampAC(MatrixXcd& A, VectorXcd& b, int current_idx, double omega) const {
+void VoltageSource::stampAC(ComplexStamper& A, VectorXcd& b, int current_idx, double omega) const {
     int n1 = getNode(0) - 1;
     int n2 = getNode(1) - 1;
-    if (n1 >= 0) A(current_idx, n1) = 1.0;
-    if (n2 >= 0) A(current_idx, n2) = -1.0;
+    if (n1 >= 0) A.add(current_idx, n1, 1.0);
+    if (n2 >= 0) A.add(current_idx, n2, -1.0);
     b(current_idx) = this->voltage;
-    if (n1 >= 0) A(n1, current_idx) = 1.0;
-    if (n2 >= 0) A(n2, current_idx) = -1.0;
+    if (n1 >= 0) A.add(n1, current_idx, 1.0);
+    if (n2 >= 0) A.add(n2, current_idx, -1.0);
 }
 
 // --- ACVoltageSource ---
@@ -174,26 +204,31 @@ void ACVoltageSource::setProperties(const map<string, double>& properties) {
     if (properties.count("Magnitude")) ac_magnitude = properties.at("Magnitude");
     if (properties.count("Phase")) ac_phase = properties.at("Phase");
 }
+ParameterHandle ACVoltageSource::parameterHandle(const string& property) {
+    if (property == "Magnitude") return ParameterHandle(&ac_magnitude);
+    if (property == "Phase") return ParameterHandle(&ac_phase);
+    return {};
+}
 map<string, double> ACVoltageSource::getProperties() const { return {{"Magnitude", ac_magnitude}, {"Phase", ac_phase}}; }
 string ACVoltageSource::getDisplayValue() const { return "AC " + formatValue(ac_magnitude) + "V"; }
-void ACVoltageSource::stamp(MatrixXd& A, VectorXd& b, const VectorXd& x_prev_nr, int current_idx, double h, double t) {
+void ACVoltageSource::stamp(RealStamper& A, VectorXd& b, const VectorXd& x_prev_nr, int current_idx, double h, double t) {
     int n1 = getNode(0) - 1;
     int n2 = getNode(1) - 1;
-    if (n1 >= 0) A(current_idx, n1) = 1.0;
-    if (n2 >= 0) A(current_idx, n2) = -1.0;
+    if (n1 >= 0) A.add(current_idx, n1, 1.0);
+    if (n2 >= 0) A.add(current_idx, n2, -1.0);
     b(current_idx) = 0.0; // DC value is zero for AC analysis
-    if (n1 >= 0) A(n1, current_idx) = 1.0;
-    if (n2 >= 0) A(n2, current_idx) = -1.0;
+    if (n1 >= 0) A.add(n1, current_idx, 1.0);
+    if (n2 >= 0) A.add(n2, current_idx, -1.0);
 }
-void ACVoltageSource::stampAC(MatrixXcd& A, VectorXcd& b, int current_idx, double omega) const {
+void ACVoltageSource::stampAC(ComplexStamper& A, VectorXcd& b, int current_idx, double omega) const {
     int n1 = getNode(0) - 1;
     int n2 = getNode(1) - 1;
     complex<double> ac_val = polar(ac_magnitude, ac_phase * M_PI / 180.0);
-    if (n1 >= 0) A(current_idx, n1) = 1.0;
-    if (n2 >= 0) A(current_idx, n2) = -1.0;
+    if (n1 >= 0) A.add(current_idx, n1, 1.0);
+    if (n2 >= 0) A.add(current_idx, n2, -1.0);
     b(current_idx) = ac_val;
-    if (n1 >= 0) A(n1, current_idx) = 1.0;
-    if (n2 >= 0) A(n2, current_idx) = -1.0;
+    if (n1 >= 0) A.add(n1, current_idx, 1.0);
+    if (n2 >= 0) A.add(n2, current_idx, -1.0);
 }
 
 // --- SinusoidalVoltageSource ---
@@ -203,25 +238,35 @@ void SinusoidalVoltageSource::setProperties(const map<string, double>& propertie
     if (properties.count("Amplitude")) v_amplitude = properties.at("Amplitude");
     if (properties.count("Frequency")) freq = properties.at("Frequency");
 }
+ParameterHandle SinusoidalVoltageSource::parameterHandle(const string& property) {
+    if (property == "Offset") return ParameterHandle(&v_offset);
+    if (property == "Amplitude") return ParameterHandle(&v_amplitude);
+    if (property == "Frequency") return ParameterHandle(&freq);
+    return {};
+}
 map<string, double> SinusoidalVoltageSource::getProperties() const {
     return {{"Offset", v_offset}, {"Amplitude", v_amplitude}, {"Frequency", freq}};
 }
 string SinusoidalVoltageSource::getDisplayValue() const { return "SIN"; }
+// 50 steps per period keep the interpolated output within 0.2% of the amplitude.
+double SinusoidalVoltageSource::maxTimeStep() const {
+    return freq > 0 ? 1.0 / (50.0 * freq) : numeric_limits<double>::infinity();
+}
 void SinusoidalVoltageSource::print() const { cout << "Type: SIN Source, Name: " << name << ", Nodes: (" << getNode(0) << "," << getNode(1) << "), SIN(" << v_offset << " " << v_amplitude << " " << freq << "Hz)" << endl; }
 string SinusoidalVoltageSource::toNetlistString() const {
     stringstream ss;
     ss << name << " " << getNode(0) << " " << getNode(1) << " SIN ( " << v_offset << " " << v_amplitude << " " << freq << " )";
     return ss.str();
 }
-void SinusoidalVoltageSource::stamp(MatrixXd& A, VectorXd& b, const VectorXd& x_prev_nr, int current_idx, double h, double t) {
+void SinusoidalVoltageSource::stamp(RealStamper& A, VectorXd& b, const VectorXd& x_prev_nr, int current_idx, double h, double t) {
     int n1 = getNode(0) - 1;
     int n2 = getNode(1) - 1;
     double instantaneous_voltage = v_offset + v_amplitude * sin(2 * M_PI * freq * t);
-    if (n1 >= 0) A(current_idx, n1) = 1.0;
-    if (n2 >= 0) A(current_idx, n2) = -1.0;
+    if (n1 >= 0) A.add(current_idx, n1, 1.0);
+    if (n2 >= 0) A.add(current_idx, n2, -1.0);
     b(current_idx) = instantaneous_voltage;
-    if (n1 >= 0) A(n1, current_idx) = 1.0;
-    if (n2 >= 0) A(n2, current_idx) = -1.0;
+    if (n1 >= 0) A.add(n1, current_idx, 1.0);
+    if (n2 >= 0) A.add(n2, current_idx, -1.0);
 }
 
 // --- PulseVoltageSource ---
@@ -235,6 +280,16 @@ void PulseVoltageSource::setProperties(const map<string, double>& properties) {
     if (properties.count("Pulse Width")) t_pulse_width = properties.at("Pulse Width");
     if (properties.count("Period")) t_period = properties.at("Period");
 }
+ParameterHandle PulseVoltageSource::parameterHandle(const string& property) {
+    if (property == "Initial Value") return ParameterHandle(&v_initial);
+    if (property == "Pulsed Value") return ParameterHandle(&v_pulsed);
+    if (property == "Delay") return ParameterHandle(&t_delay);
+    if (property == "Rise Time") return ParameterHandle(&t_rise);
+    if (property == "Fall Time") return ParameterHandle(&t_fall);
+    if (property == "Pulse Width") return ParameterHandle(&t_pulse_width);
+    if (property == "Period") return ParameterHandle(&t_period);
+    return {};
+}
 map<string, double> PulseVoltageSource::getProperties() const {
     return {
             {"Initial Value", v_initial}, {"Pulsed Value", v_pulsed},
@@ -270,99 +325,120 @@ double PulseVoltageSource::calculate_voltage_at(double t) const {
     if (t_fall > 0 && t <= t_fall) return v_pulsed + (v_initial - v_pulsed) * t / t_fall;
     return v_initial;
 }
-void PulseVoltageSource::stamp(MatrixXd& A, VectorXd& b, const VectorXd& x_prev_nr, int current_idx, double h, double t) {
+// Corners of the pulse: start and end of the rise and of the fall, repeated every period.
+double PulseVoltageSource::nextBreakpoint(double t) const {
+    const double corners[] = {t_delay, t_delay + t_rise, t_delay + t_rise + t_pulse_width, t_delay + t_rise + t_pulse_width + t_fall};
+    if (t_period <= 0) {
+        for (double c : corners) {
+            if (c > t) return c;
+        }
+        return numeric_limits<double>::infinity();
+    }
+    double start = floor(t / t_period) * t_period;
+    for (double c : corners) {
+        if (c < t_period && start + c > t) return start + c;
+    }
+    return start + t_period;
+}
+void PulseVoltageSource::stamp(RealStamper& A, VectorXd& b, const VectorXd& x_prev_nr, int current_idx, double h, double t) {
     int n1 = getNode(0) - 1;
     int n2 = getNode(1) - 1;
     double instantaneous_voltage = calculate_voltage_at(t);
-    if (n1 >= 0) A(current_idx, n1) = 1.0;
-    if (n2 >= 0) A(current_idx, n2) = -1.0;
+    if (n1 >= 0) A.add(current_idx, n1, 1.0);
+    if (n2 >= 0) A.add(current_idx, n2, -1.0);
     b(current_idx) = instantaneous_voltage;
-    if (n1 >= 0) A(n1, current_idx) = 1.0;
-    if (n2 >= 0) A(n2, current_idx) = -1.0;
+    if (n1 >= 0) A.add(n1, current_idx, 1.0);
+    if (n2 >= 0) A.add(n2, current_idx, -1.0);
 }
 
 // --- Diode ---
 Diode::Diode(const string& name, int n1, int n2, const DiodeModel& modelParams) : Component(name, {n1, n2}) { this->modelName = modelParams.name; this->Is = modelParams.Is; this->Vt = modelParams.Vt; this->n = modelParams.n; this->Vz = modelParams.Vz; }
 void Diode::print() const { cout << "Type: Diode, Name: " << name << ", Nodes: (" << getNode(0) << "," << getNode(1) << "), Model: " << modelName << endl; }
 string Diode::toNetlistString() const { return name + " " + to_string(getNode(0)) + " " + to_string(getNode(1)) + " " + modelName; }
-void Diode::stamp(MatrixXd& A, VectorXd& b, const VectorXd& x_prev_nr, int current_idx, double h, double t) {
+void Diode::stamp(RealStamper& A, VectorXd& b, const VectorXd& x_prev_nr, int current_idx, double h, double t) {
     int n1 = getNode(0) - 1;
     int n2 = getNode(1) - 1;
     double v1 = (n1 >= 0) ? x_prev_nr(n1) : 0.0;
     double v2 = (n2 >= 0) ? x_prev_nr(n2) : 0.0;
     double Vd = v1 - v2;
-    if (Vz > 0 && Vd < -Vz) {
-        const double Gz = 100.0;
-        double Ieq_zener = Gz * Vz;
-        if (n1 >= 0) { A(n1, n1) += Gz; b(n1) -= Ieq_zener; }
-        if (n2 >= 0) { A(n2, n2) += Gz; b(n2) += Ieq_zener; }
-        if (n1 >= 0 && n2 >= 0) { A(n1, n2) -= Gz; A(n2, n1) -= Gz; }
-        return;
+    double nVt = n * Vt;
+    DiodeStep step = diodeStep(Vd, v_junction, v_evaluated, evaluated, nVt, diodeCriticalVoltage(nVt, Is), Vz, bypassReltol, bypassVntol);
+    limited = step.limited;
+    if (step.bypassed) {
+        // Quiescent: restamp the previous linearization without touching exp().
+        bypassed++;
+    } else {
+        v_junction = step.vJunction;
+        v_evaluated = step.vEvaluated;
+        evaluated = step.evaluated;
+        if (step.needsExp) diodeExpLinearization(Is, nVt, v_junction, exp(v_junction / nVt), G_last, Ieq_last);
+        else { G_last = step.G; Ieq_last = step.Ieq; }
     }
-    double Vd_limited = (Vd > 0.7) ? 0.7 : Vd;
-    double exp_val = exp(Vd_limited / (n * Vt));
-    double Id = Is * (exp_val - 1.0);
-    double Geq = (Is / (n * Vt)) * exp_val;
-    double Ieq_comp = Id - Geq * Vd_limited;
-    if (n1 >= 0) { A(n1, n1) += Geq; b(n1) -= Ieq_comp; }
-    if (n2 >= 0) { A(n2, n2) += Geq; b(n2) += Ieq_comp; }
-    if (n1 >= 0 && n2 >= 0) { A(n1, n2) -= Geq; A(n2, n1) -= Geq; }
+    evaluations++;
+    if (n1 >= 0) { A.add(n1, n1, G_last); b(n1) -= Ieq_last; }
+    if (n2 >= 0) { A.add(n2, n2, G_last); b(n2) += Ieq_last; }
+    if (n1 >= 0 && n2 >= 0) { A.add(n1, n2, -G_last); A.add(n2, n1, -G_last); }
 }
-void Diode::stampAC(MatrixXcd& A, VectorXcd& b, int current_idx, double omega) const { /* AC model for diode not implemented */ }
+void Diode::stampAC(ComplexStamper& A, VectorXcd& b, int current_idx, double omega) const { /* AC model for diode not implemented */ }
 
 // --- VCVS ---
 VCVS::VCVS(const string& name, int n1, int n2, int ctrl_n1, int ctrl_n2, double gain) : Component(name, {n1, n2}), ctrlNode1(ctrl_n1), ctrlNode2(ctrl_n2), gain(gain) {}
 void VCVS::setProperties(const map<string, double>& properties) { if (properties.count("Gain")) gain = properties.at("Gain"); }
+ParameterHandle VCVS::parameterHandle(const string& property) { return property == "Gain" ? ParameterHandle(&gain) : ParameterHandle(); }
 map<string, double> VCVS::getProperties() const { return {{"Gain", gain}}; }
 string VCVS::getDisplayValue() const { return "Gain=" + formatValue(gain); }
 void VCVS::print() const { cout << "Type: VCVS, Name: " << name << ", Out: (" << getNode(0) << "," << getNode(1) << "), Control: (" << ctrlNode1 << "," << ctrlNode2 << "), Gain=" << gain << endl; }
 string VCVS::toNetlistString() const { return name + " " + to_string(getNode(0)) + " " + to_string(getNode(1)) + " " + to_string(ctrlNode1) + " " + to_string(ctrlNode2) + " " + to_string(gain); }
 void VCVS::updateCtrlNodes(int oldNode, int newNode) { if (ctrlNode1 == oldNode) ctrlNode1 = newNode; if (ctrlNode2 == oldNode) ctrlNode2 = newNode; }
-void VCVS::stamp(MatrixXd& A, VectorXd& b, const VectorXd& x_prev_nr, int current_idx, double h, double t) {
+void VCVS::remapCtrlNodes(const map<int, int>& nodeMap) { ctrlNode1 = remappedNode(nodeMap, ctrlNode1); ctrlNode2 = remappedNode(nodeMap, ctrlNode2); }
+void VCVS::stamp(RealStamper& A, VectorXd& b, const VectorXd& x_prev_nr, int current_idx, double h, double t) {
     int n1 = getNode(0) - 1; int n2 = getNode(1) - 1;
     int cn1 = ctrlNode1 - 1; int cn2 = ctrlNode2 - 1;
-    if (n1 >= 0) A(current_idx, n1) = 1.0;
-    if (n2 >= 0) A(current_idx, n2) = -1.0;
-    if (cn1 >= 0) A(current_idx, cn1) = -gain;
-    if (cn2 >= 0) A(current_idx, cn2) = gain;
-    if (n1 >= 0) A(n1, current_idx) = 1.0;
-    if (n2 >= 0) A(n2, current_idx) = -1.0;
-}
-void VCVS::stampAC(MatrixXcd& A, VectorXcd& b, int current_idx, double omega) const {
+    if (n1 >= 0) A.add(current_idx, n1, 1.0);
+    if (n2 >= 0) A.add(current_idx, n2, -1.0);
+    if (cn1 >= 0) A.add(current_idx, cn1, -gain);
+    if (cn2 >= 0) A.add(current_idx, cn2, gain);
+    if (n1 >= 0) A.add(n1, current_idx, 1.0);
+    if (n2 >= 0) A.add(n2, current_idx, -1.0);
+}
+void VCVS::stampAC(ComplexStamper& A, VectorXcd& b, int current_idx, double omega) const {
     int n1 = getNode(0) - 1; int n2 = getNode(1) - 1;
     int cn1 = ctrlNode1 - 1; int cn2 = ctrlNode2 - 1;
-    if (n1 >= 0) A(current_idx, n1) = 1.0;
-    if (n2 >= 0) A(current_idx, n2) = -1.0;
-    if (cn1 >= 0) A(current_idx, cn1) = -gain;
-    if (cn2 >= 0) A(current_idx, cn2) = gain;
-    if (n1 >= 0) A(n1, current_idx) = 1.0;
-    if (n2 >= 0) A(n2, current_idx) = -1.0;
+    if (n1 >= 0) A.add(current_idx, n1, 1.0);
+    if (n2 >= 0) A.add(current_idx, n2, -1.0);
+    if (cn1 >= 0) A.add(current_idx, cn1, -gain);
+    if (cn2 >= 0) A.add(current_idx, cn2, gain);
+    if (n1 >= 0) A.add(n1, current_idx, 1.0);
+    if (n2 >= 0) A.add(n2, current_idx, -1.0);
 }
 
 // --- VCCS ---
 VCCS::VCCS(const string& name, int n1, int n2, int ctrl_n1, int ctrl_n2, double gain) : Component(name, {n1, n2}), ctrlNode1(ctrl_n1), ctrlNode2(ctrl_n2), gain(gain) {}
 void VCCS::setProperties(const map<string, double>& properties) { if (properties.count("Gain")) gain = properties.at("Gain"); }
+ParameterHandle VCCS::parameterHandle(const string& property) { return property == "Gain" ? ParameterHandle(&gain) : ParameterHandle(); }
 map<string, double> VCCS::getProperties() const { return {{"Gain", gain}}; }
 string VCCS::getDisplayValue() const { return "Gain=" + formatValue(gain); }
 void VCCS::print() const { cout << "Type: VCCS, Name: " << name << ", Out: (" << getNode(0) << "->" << getNode(1) << "), Control: (" << ctrlNode1 << "," << ctrlNode2 << "), Gain=" << gain << endl; }
 string VCCS::toNetlistString() const { return name + " " + to_string(getNode(0)) + " " + to_string(getNode(1)) + " " + to_string(ctrlNode1) + " " + to_string(ctrlNode2) + " " + to_string(gain); }
 void VCCS::updateCtrlNodes(int oldNode, int newNode) { if (ctrlNode1 == oldNode) ctrlNode1 = newNode; if (ctrlNode2 == oldNode) ctrlNode2 = newNode; }
-void VCCS::stamp(MatrixXd& A, VectorXd& b, const VectorXd& x_prev_nr, int current_idx, double h, double t) {
+void VCCS::remapCtrlNodes(const map<int, int>& nodeMap) { ctrlNode1 = remappedNode(nodeMap, ctrlNode1); ctrlNode2 = remappedNode(nodeMap, ctrlNode2); }
+void VCCS::stamp(RealStamper& A, VectorXd& b, const VectorXd& x_prev_nr, int current_idx, double h, double t) {
     int n1 = getNode(0) - 1; int n2 = getNode(1) - 1;
     int cn1 = ctrlNode1 - 1; int cn2 = ctrlNode2 - 1;
-    if (n1 >= 0) { if (cn1 >= 0) A(n1, cn1) += gain; if (cn2 >= 0) A(n1, cn2) -= gain; }
-    if (n2 >= 0) { if (cn1 >= 0) A(n2, cn1) -= gain; if (cn2 >= 0) A(n2, cn2) += gain; }
+    if (n1 >= 0) { if (cn1 >= 0) A.add(n1, cn1, gain); if (cn2 >= 0) A.add(n1, cn2, -gain); }
+    if (n2 >= 0) { if (cn1 >= 0) A.add(n2, cn1, -gain); if (cn2 >= 0) A.add(n2, cn2, gain); }
 }
-void VCCS::stampAC(MatrixXcd& A, VectorXcd& b, int current_idx, double omega) const {
+void VCCS::stampAC(ComplexStamper& A, VectorXcd& b, int current_idx, double omega) const {
     int n1 = getNode(0) - 1; int n2 = getNode(1) - 1;
     int cn1 = ctrlNode1 - 1; int cn2 = ctrlNode2 - 1;
-    if (n1 >= 0) { if (cn1 >= 0) A(n1, cn1) += gain; if (cn2 >= 0) A(n1, cn2) -= gain; }
-    if (n2 >= 0) { if (cn1 >= 0) A(n2, cn1) -= gain; if (cn2 >= 0) A(n2, cn2) += gain; }
+    if (n1 >= 0) { if (cn1 >= 0) A.add(n1, cn1, gain); if (cn2 >= 0) A.add(n1, cn2, -gain); }
+    if (n2 >= 0) { if (cn1 >= 0) A.add(n2, cn1, -gain); if (cn2 >= 0) A.add(n2, cn2, gain); }
 }
 
 // --- CCVS ---
 CCVS::CCVS(const string& name, int n1, int n2, const string& vctrl_name, double gain) : Component(name, {n1, n2}), ctrlVName(vctrl_name), gain(gain) {}
 void CCVS::setProperties(const map<string, double>& properties) { if (properties.count("Gain")) gain = properties.at("Gain"); }
+ParameterHandle CCVS::parameterHandle(const string& property) { return property == "Gain" ? ParameterHandle(&gain) : ParameterHandle(); }
 map<string, double> CCVS::getProperties() const { return {{"Gain", gain}}; }
 string CCVS::getDisplayValue() const { return "Gain=" + formatValue(gain); }
 void CCVS::print() const { cout << "Type: CCVS, Name: " << name << ", Out: (" << getNode(0) << "," << getNode(1) << "), Control Current: I(" << ctrlVName << "), Gain=" << gain << endl; }
@@ -373,26 +449,27 @@ string CCVS::toNetlistString() const {
     return name + " " + to_string(getNode(0)) + " " + to_string(getNode(1)) + " " + ctrlVName + " " + to_string(gain);
 }
 
-void CCVS::stamp(MatrixXd& A, VectorXd& b, const VectorXd& x_prev_nr, int current_idx, double h, double t) {
+void CCVS::stamp(RealStamper& A, VectorXd& b, const VectorXd& x_prev_nr, int current_idx, double h, double t) {
     int n1 = getNode(0) - 1; int n2 = getNode(1) - 1;
-    if (n1 >= 0) A(current_idx, n1) = 1.0;
-    if (n2 >= 0) A(current_idx, n2) = -1.0;
-    if (ctrlCurrentIdx != -1) A(current_idx, ctrlCurrentIdx) = gain;
-    if (n1 >= 0) A(n1, current_idx) = 1.0;
-    if (n2 >= 0) A(n2, current_idx) = -1.0;
+    if (n1 >= 0) A.add(current_idx, n1, 1.0);
+    if (n2 >= 0) A.add(current_idx, n2, -1.0);
+    if (ctrlCurrentIdx != -1) A.add(current_idx, ctrlCurrentIdx, gain);
+    if (n1 >= 0) A.add(n1, current_idx, 1.0);
+    if (n2 >= 0) A.add(n2, current_idx, -1.0);
 }
-void CCVS::stampAC(MatrixXcd& A, VectorXcd& b, int current_idx, double omega) const {
+void CCVS::stampAC(ComplexStamper& A, VectorXcd& b, int current_idx, double omega) const {
     int n1 = getNode(0) - 1; int n2 = getNode(1) - 1;
-    if (n1 >= 0) A(current_idx, n1) = 1.0;
-    if (n2 >= 0) A(current_idx, n2) = -1.0;
-    if (ctrlCurrentIdx != -1) A(current_idx, ctrlCurrentIdx) = gain;
-    if (n1 >= 0) A(n1, current_idx) = 1.0;
-    if (n2 >= 0) A(n2, current_idx) = -1.0;
+    if (n1 >= 0) A.add(current_idx, n1, 1.0);
+    if (n2 >= 0) A.add(current_idx, n2, -1.0);
+    if (ctrlCurrentIdx != -1) A.add(current_idx, ctrlCurrentIdx, gain);
+    if (n1 >= 0) A.add(n1, current_idx, 1.0);
+    if (n2 >= 0) A.add(n2, current_idx, -1.0);
 }
 
 // --- CCCS ---
 CCCS::CCCS(const string& name, int n1, int n2, const string& vctrl_name, double gain) : Component(name, {n1, n2}), ctrlVName(vctrl_name), gain(gain) {}
 void CCCS::setProperties(const map<string, double>& properties) { if (properties.count("Gain")) gain = properties.at("Gain"); }
+ParameterHandle CCCS::parameterHandle(const string& property) { return property == "Gain" ? ParameterHandle(&gain) : ParameterHandle(); }
 map<string, double> CCCS::getProperties() const { return {{"Gain", gain}}; }
 string CCCS::getDisplayValue() const { return "Gain=" + formatValue(gain); }
 void CCCS::print() const { cout << "Type: CCCS, Name: " << name << ", Out: (" << getNode(0) << "->" << getNode(1) << "), Control Current: I(" << ctrlVName << "), Gain=" << gain << endl; }
@@ -403,20 +480,20 @@ string CCCS::toNetlistString() const {
     return name + " " + to_string(getNode(0)) + " " + to_string(getNode(1)) + " " + ctrlVName + " " + to_string(gain);
 }
 
-void CCCS::stamp(MatrixXd& A, VectorXd& b, const VectorXd& x_prev_nr, int current_idx, double h, double t) {
+void CCCS::stamp(RealStamper& A, VectorXd& b, const VectorXd& x_prev_nr, int current_idx, double h, double t) {
     int n1 = getNode(0) - 1;
     int n2 = getNode(1) - 1;
     if (ctrlCurrentIdx != -1) {
-        if (n1 >= 0) A(n1, ctrlCurrentIdx) += gain;
-        if (n2 >= 0) A(n2, ctrlCurrentIdx) -= gain;
+        if (n1 >= 0) A.add(n1, ctrlCurrentIdx, gain);
+        if (n2 >= 0) A.add(n2, ctrlCurrentIdx, -gain);
     }
 }
-void CCCS::stampAC(MatrixXcd& A, VectorXcd& b, int current_idx, double omega) const {
+void CCCS::stampAC(ComplexStamper& A, VectorXcd& b, int current_idx, double omega) const {
     int n1 = getNode(0) - 1;
     int n2 = getNode(1) - 1;
     if (ctrlCurrentIdx != -1) {
-        if (n1 >= 0) A(n1, ctrlCurrentIdx) += gain;
-        if (n2 >= 0) A(n2, ctrlCurrentIdx) -= gain;
+        if (n1 >= 0) A.add(n1, ctrlCurrentIdx, gain);
+        if (n2 >= 0) A.add(n2, ctrlCurrentIdx, -gain);
     }
 }
 
@@ -424,8 +501,8 @@ void CCCS::stampAC(MatrixXcd& A, VectorXcd& b, int current_idx, double omega) co
 Ground::Ground(const string& name, int n1) : Component(name, {n1}) {}
 void Ground::print() const { cout << "Type: Ground, Name: " << name << ", Node: " << getNode(0) << endl; }
 string Ground::toNetlistString() const { return name + " " + to_string(getNode(0)); }
-void Ground::stamp(MatrixXd& A, VectorXd& b, const VectorXd& x_prev_nr, int current_idx, double h, double t) { /* Ground does not stamp */ }
-void Ground::stampAC(MatrixXcd& A, VectorXcd& b, int current_idx, double omega) const { /* Ground does not stamp */ }
+void Ground::stamp(RealStamper& A, VectorXd& b, const VectorXd& x_prev_nr, int current_idx, double h, double t) { /* Ground does not stamp */ }
+void Ground::stampAC(ComplexStamper& A, VectorXcd& b, int current_idx, double omega) const { /* Ground does not stamp */ }
 
 
 WaveformVoltageSource::WaveformVoltageSource(const string& name, int n1, int n2, const string& filePath)
@@ -464,6 +541,12 @@ double WaveformVoltageSource::getVoltageAt(double t) const {
     return it->second;
 }
 
+// The table is held piecewise constant, so every sample time is a jump.
+double WaveformVoltageSource::nextBreakpoint(double t) const {
+    auto it = m_waveform.upper_bound(t);
+    return it == m_waveform.end() ? numeric_limits<double>::infinity() : it->first;
+}
+
 void WaveformVoltageSource::print() const {
     cout << "Type: Waveform Source, Name: " << name << ", File: " << m_filePath << endl;
 }
@@ -476,16 +559,16 @@ string WaveformVoltageSource::getDisplayValue() const {
     return "WAVE";
 }
 
-void WaveformVoltageSource::stamp(MatrixXd& A, VectorXd& b, const VectorXd& x_prev_nr, int current_idx, double h, double t) {
+void WaveformVoltageSource::stamp(RealStamper& A, VectorXd& b, const VectorXd& x_prev_nr, int current_idx, double h, double t) {
     int n1 = getNode(0) - 1;
     int n2 = getNode(1) - 1;
     double instantaneous_voltage = getVoltageAt(t);
 
-    if (n1 >= 0) A(current_idx, n1) = 1.0;
-    if (n2 >= 0) A(current_idx, n2) = -1.0;
+    if (n1 >= 0) A.add(current_idx, n1, 1.0);
+    if (n2 >= 0) A.add(current_idx, n2, -1.0);
     b(current_idx) = instantaneous_voltage;
-    if (n1 >= 0) A(n1, current_idx) = 1.0;
-    if (n2 >= 0) A(n2, current_idx) = -1.0;
+    if (n1 >= 0) A.add(n1, current_idx, 1.0);
+    if (n2 >= 0) A.add(n2, current_idx, -1.0);
 }
 
 WirelessVoltageSource::WirelessVoltageSource(const string& name, int n1, int n2)
@@ -7,8 +7,11 @@
 #include <iostream>
 #include <map>
 #include <complex>
+#include <limits>
 #include <Eigen/Dense>
 #include "DiodeModel.h"
+#include "MNAStamper.h"
+#include "ReactiveState.h"
 #include <QPointF>
 #include <cereal/cereal.hpp>
 #include <cereal/types/base_class.hpp>
@@ -19,6 +22,22 @@
 using namespace std;
 using namespace Eigen;
 
+// A numeric component parameter ("Voltage", "Resistance", "Phase", ...) resolved once by
+// name, so sweeps can set it repeatedly without building a property map or comparing strings.
+// It points into the component and is valid as long as the component is. A parameter that
+// enters the matrix (R, C, L, gains) only takes effect in an analysis after its stamp plan is
+// compiled again; source values are restamped at every point.
+class ParameterHandle {
+public:
+    ParameterHandle() = default;
+    explicit ParameterHandle(double* target) : target(target) {}
+    explicit operator bool() const { return target != nullptr; }
+    void set(double value) const { *target = value; }
+    double get() const { return *target; }
+private:
+    double* target = nullptr;
+};
+
 class Component {
 public:
     Component() : ctrlCurrentIdx(-1), posX(0), posY(0) {}
@@ -29,12 +48,31 @@ public:
 
     virtual string toNetlistString() const = 0;
     virtual void print() const = 0;
-    virtual void stamp(MatrixXd& A, VectorXd& b, const VectorXd& x_prev_nr, int current_idx, double h, double t) = 0;
-    virtual void stampAC(MatrixXcd& A, VectorXcd& b, int current_idx, double omega) const = 0;
+    virtual void stamp(RealStamper& A, VectorXd& b, const VectorXd& x_prev_nr, int current_idx, double h, double t) = 0;
+    virtual void stampAC(ComplexStamper& A, VectorXcd& b, int current_idx, double omega) const = 0;
 
     virtual bool addsCurrentVariable() const { return false; }
     virtual bool isNonLinear() const { return false; }
+    // True when the last stamp limited its controlling voltage, so the Newton iterate it was
+    // linearized at cannot be accepted as converged yet.
+    virtual bool isLimiting() const { return false; }
+    // Device bypass for nonlinear elements: when the controlling voltage moved by less than
+    // reltol * |v| + vntol since the last evaluation, the previous linearization is restamped.
+    // vntol <= 0 turns bypass off. The counts cover nonlinear stamps since resetState().
+    virtual void setBypassTolerance(double reltol, double vntol) {}
+    virtual long evaluationCount() const { return 0; }
+    virtual long bypassCount() const { return 0; }
+    // True when the matrix stamp depends on the time step h (companion models).
+    virtual bool isReactive() const { return false; }
+    // First time strictly after t at which the source waveform has a corner or a jump;
+    // transient analysis lands a step exactly there. Infinity when there is none.
+    virtual double nextBreakpoint(double t) const { return numeric_limits<double>::infinity(); }
+    // Longest transient step that still follows a smooth source waveform; infinity if any.
+    virtual double maxTimeStep() const { return numeric_limits<double>::infinity(); }
     virtual void resetState() {}
+    // Reactive devices take a slot in the circuit's integration history; branchRow is the
+    // row of their branch current, -1 if they have none.
+    virtual void bindReactiveState(ReactiveState& state, int branchRow) {}
 
     string getName() const { return name; }
     void setName(const string& n) { name = n; }
@@ -42,12 +80,16 @@ public:
     const std::vector<int>& getNodes() const { return nodes; }
     int getNode(size_t index) const { return (index < nodes.size()) ? nodes[index] : -1; }
     void updateNode(int oldNode, int newNode);
+    // Renumbers all nodes (including control nodes) at once; ids missing from nodeMap are kept.
+    void remapNodes(const map<int, int>& nodeMap);
     void setNodes(const std::vector<int>& n) { nodes = n; }
 
     void setCtrlCurrentIdx(int idx) { ctrlCurrentIdx = idx; }
     virtual string getCtrlVName() const { return ""; }
     virtual void setProperties(const map<string, double>& properties);
     virtual map<string, double> getProperties() const;
+    // Handle to the parameter setProperties() knows as `property`; empty if there is none.
+    virtual ParameterHandle parameterHandle(const string& property) { return {}; }
     virtual string getDisplayValue() const;
 
     void setPosition(double x, double y) { posX = x; posY = y; }
@@ -72,10 +114,11 @@ public:
     Resistor(const string& name, int n1, int n2, double res);
     unique_ptr<Component> clone() const override { return make_unique<Resistor>(*this); }
     void print() const override;
-    void stamp(MatrixXd& A, VectorXd& b, const VectorXd& x_prev_nr, int current_idx, double h, double t) override;
-    void stampAC(MatrixXcd& A, VectorXcd& b, int current_idx, double omega) const override;
+    void stamp(RealStamper& A, VectorXd& b, const VectorXd& x_prev_nr, int current_idx, double h, double t) override;
+    void stampAC(ComplexStamper& A, VectorXcd& b, int current_idx, double omega) const override;
     string toNetlistString() const override;
     void setProperties(const map<string, double>& properties) override;
+    ParameterHandle parameterHandle(const string& property) override;
     map<string, double> getProperties() const override;
     string getDisplayValue() const override;
     template<class Archive> void serialize(Archive & ar) { ar(cereal::base_class<Component>(this), CEREAL_NVP(resistance)); }
@@ -85,43 +128,53 @@ private:
 
 class Capacitor : public Component {
 public:
-    Capacitor() : capacitance(0.0), prev_voltage(0.0) {}
+    Capacitor() : capacitance(0.0) {}
     Capacitor(const string& name, int n1, int n2, double cap);
-    unique_ptr<Component> clone() const override { return make_unique<Capacitor>(*this); }
+    // A copy belongs to no analysis until it is bound again.
+    unique_ptr<Component> clone() const override { auto copy = make_unique<Capacitor>(*this); copy->history = nullptr; return copy; }
     void print() const override;
-    void stamp(MatrixXd& A, VectorXd& b, const VectorXd& x_prev_nr, int current_idx, double h, double t) override;
-    void stampAC(MatrixXcd& A, VectorXcd& b, int current_idx, double omega) const override;
+    void stamp(RealStamper& A, VectorXd& b, const VectorXd& x_prev_nr, int current_idx, double h, double t) override;
+    void stampAC(ComplexStamper& A, VectorXcd& b, int current_idx, double omega) const override;
     string toNetlistString() const override;
     void setProperties(const map<string, double>& properties) override;
+    ParameterHandle parameterHandle(const string& property) override;
     map<string, double> getProperties() const override;
     string getDisplayValue() const override;
-    void updateVoltage(double new_voltage) { prev_voltage = new_voltage; }
-    void resetState() override { prev_voltage = 0.0; }
-    template<class Archive> void serialize(Archive & ar) { ar(cereal::base_class<Component>(this), CEREAL_NVP(capacitance), CEREAL_NVP(prev_voltage)); }
+    bool isReactive() const override { return true; }
+    void bindReactiveState(ReactiveState& state, int branchRow) override;
+    int stateSlot() const { return slot; }
+    // prev_voltage is only kept in the archive so that saved circuits still load.
+    template<class Archive> void serialize(Archive & ar) { double prev_voltage = 0.0; ar(cereal::base_class<Component>(this), CEREAL_NVP(capacitance), CEREAL_NVP(prev_voltage)); }
 private:
     double capacitance;
-    double prev_voltage;
+    // Slot in the history of the analysis this capacitor belongs to; unbound it starts from zero.
+    ReactiveState* history = nullptr;
+    int slot = -1;
 };
 
 class Inductor : public Component {
 public:
-    Inductor() : inductance(0.0), prev_current(0.0) {}
+    Inductor() : inductance(0.0) {}
     Inductor(const string& name, int n1, int n2, double ind);
-    unique_ptr<Component> clone() const override { return make_unique<Inductor>(*this); }
+    unique_ptr<Component> clone() const override { auto copy = make_unique<Inductor>(*this); copy->history = nullptr; return copy; }
     void print() const override;
-    void stamp(MatrixXd& A, VectorXd& b, const VectorXd& x_prev_nr, int current_idx, double h, double t) override;
-    void stampAC(MatrixXcd& A, VectorXcd& b, int current_idx, double omega) const override;
+    void stamp(RealStamper& A, VectorXd& b, const VectorXd& x_prev_nr, int current_idx, double h, double t) override;
+    void stampAC(ComplexStamper& A, VectorXcd& b, int current_idx, double omega) const override;
     bool addsCurrentVariable() const override { return true; }
     string toNetlistString() const override;
     void setProperties(const map<string, double>& properties) override;
+    ParameterHandle parameterHandle(const string& property) override;
     map<string, double> getProperties() const override;
     string getDisplayValue() const override;
-    void updateCurrent(double new_current) { prev_current = new_current; }
-    void resetState() override { prev_current = 0.0; }
-    template<class Archive> void serialize(Archive & ar) { ar(cereal::base_class<Component>(this), CEREAL_NVP(inductance), CEREAL_NVP(prev_current)); }
+    bool isReactive() const override { return true; }
+    void bindReactiveState(ReactiveState& state, int branchRow) override;
+    int stateSlot() const { return slot; }
+    template<class Archive> void serialize(Archive & ar) { double prev_current = 0.0; ar(cereal::base_class<Component>(this), CEREAL_NVP(inductance), CEREAL_NVP(prev_current)); }
 private:
     double inductance;
-    double prev_current;
+    // As in Capacitor.
+    ReactiveState* history = nullptr;
+    int slot = -1;
 };
 
 class CurrentSource : public Component {
@@ -130,10 +183,11 @@ public:
     CurrentSource(const string& name, int n1, int n2, double current);
     unique_ptr<Component> clone() const override { return make_unique<CurrentSource>(*this); }
     void print() const override;
-    void stamp(MatrixXd& A, VectorXd& b, const VectorXd& x_prev_nr, int current_idx, double h, double t) override;
-    void stampAC(MatrixXcd& A, VectorXcd& b, int current_idx, double omega) const override;
+    void stamp(RealStamper& A, VectorXd& b, const VectorXd& x_prev_nr, int current_idx, double h, double t) override;
+    void stampAC(ComplexStamper& A, VectorXcd& b, int current_idx, double omega) const override;
     string toNetlistString() const override;
     void setProperties(const map<string, double>& properties) override;
+    ParameterHandle parameterHandle(const string& property) override;
     map<string, double> getProperties() const override;
     string getDisplayValue() const override;
     template<class Archive> void serialize(Archive & ar) { ar(cereal::base_class<Component>(this), CEREAL_NVP(current)); }
@@ -147,11 +201,12 @@ public:
     VoltageSource(const string& name, int n1, int n2, double vol);
     unique_ptr<Component> clone() const override { return make_unique<VoltageSource>(*this); }
     virtual void print() const override;
-    virtual void stamp(MatrixXd& A, VectorXd& b, const VectorXd& x_prev_nr, int current_idx, double h, double t) override;
-    virtual void stampAC(MatrixXcd& A, VectorXcd& b, int current_idx, double omega) const override;
+    virtual void stamp(RealStamper& A, VectorXd& b, const VectorXd& x_prev_nr, int current_idx, double h, double t) override;
+    virtual void stampAC(ComplexStamper& A, VectorXcd& b, int current_idx, double omega) const override;
     bool addsCurrentVariable() const override { return true; }
     string toNetlistString() const override;
     void setProperties(const map<string, double>& properties) override;
+    ParameterHandle parameterHandle(const string& property) override;
     map<string, double> getProperties() const override;
     string getDisplayValue() const override;
     template<class Archive> void serialize(Archive & ar) { ar(cereal::base_class<Component>(this), CEREAL_NVP(voltage)); }
@@ -165,10 +220,11 @@ public:
     ACVoltageSource(const string& name, int n1, int n2, double magnitude, double phase = 0.0) : VoltageSource(name, n1, n2, 0.0), ac_magnitude(magnitude), ac_phase(phase) {}
     unique_ptr<Component> clone() const override { return make_unique<ACVoltageSource>(*this); }
     void print() const override;
-    void stamp(MatrixXd& A, VectorXd& b, const VectorXd& x_prev_nr, int current_idx, double h, double t) override;
-    void stampAC(MatrixXcd& A, VectorXcd& b, int current_idx, double omega) const override;
+    void stamp(RealStamper& A, VectorXd& b, const VectorXd& x_prev_nr, int current_idx, double h, double t) override;
+    void stampAC(ComplexStamper& A, VectorXcd& b, int current_idx, double omega) const override;
     string toNetlistString() const override;
     void setProperties(const map<string, double>& properties) override;
+    ParameterHandle parameterHandle(const string& property) override;
     map<string, double> getProperties() const override;
     string getDisplayValue() const override;
     template<class Archive> void serialize(Archive & ar) { ar(cereal::base_class<VoltageSource>(this), CEREAL_NVP(ac_magnitude), CEREAL_NVP(ac_phase)); }
@@ -183,11 +239,13 @@ public:
     SinusoidalVoltageSource(const string& name, int n1, int n2, double offset, double amplitude, double frequency);
     unique_ptr<Component> clone() const override { return make_unique<SinusoidalVoltageSource>(*this); }
     void print() const override;
-    void stamp(MatrixXd& A, VectorXd& b, const VectorXd& x_prev_nr, int current_idx, double h, double t) override;
+    void stamp(RealStamper& A, VectorXd& b, const VectorXd& x_prev_nr, int current_idx, double h, double t) override;
     string toNetlistString() const override;
     void setProperties(const map<string, double>& properties) override;
+    ParameterHandle parameterHandle(const string& property) override;
     map<string, double> getProperties() const override;
     string getDisplayValue() const override;
+    double maxTimeStep() const override;
     template<class Archive> void serialize(Archive & ar) { ar(cereal::base_class<VoltageSource>(this), CEREAL_NVP(v_offset), CEREAL_NVP(v_amplitude), CEREAL_NVP(freq)); }
 private:
     double v_offset, v_amplitude, freq;
@@ -199,11 +257,13 @@ public:
     PulseVoltageSource(const string& name, int n1, int n2, double v1, double v2, double td, double tr, double tf, double pw, double per);
     unique_ptr<Component> clone() const override { return make_unique<PulseVoltageSource>(*this); }
     void print() const override;
-    void stamp(MatrixXd& A, VectorXd& b, const VectorXd& x_prev_nr, int current_idx, double h, double t) override;
+    void stamp(RealStamper& A, VectorXd& b, const VectorXd& x_prev_nr, int current_idx, double h, double t) override;
     string toNetlistString() const override;
     void setProperties(const map<string, double>& properties) override;
+    ParameterHandle parameterHandle(const string& property) override;
     map<string, double> getProperties() const override;
     string getDisplayValue() const override;
+    double nextBreakpoint(double t) const override;
     template<class Archive> void serialize(Archive & ar) { ar(cereal::base_class<VoltageSource>(this), CEREAL_NVP(v_initial), CEREAL_NVP(v_pulsed), CEREAL_NVP(t_delay), CEREAL_NVP(t_rise), CEREAL_NVP(t_fall), CEREAL_NVP(t_pulse_width), CEREAL_NVP(t_period)); }
 private:
     double v_initial, v_pulsed, t_delay, t_rise, t_fall, t_pulse_width, t_period;
@@ -216,9 +276,10 @@ public:
     WaveformVoltageSource(const string& name, int n1, int n2, const string& filePath);
     unique_ptr<Component> clone() const override { return make_unique<WaveformVoltageSource>(*this); }
     void print() const override;
-    void stamp(MatrixXd& A, VectorXd& b, const VectorXd& x_prev_nr, int current_idx, double h, double t) override;
+    void stamp(RealStamper& A, VectorXd& b, const VectorXd& x_prev_nr, int current_idx, double h, double t) override;
     string toNetlistString() const override;
     string getDisplayValue() const override;
+    double nextBreakpoint(double t) const override;
 
     template<class Archive>
     void serialize(Archive & ar) {
@@ -249,14 +310,29 @@ public:
     Diode(const string& name, int n1, int n2, const DiodeModel& modelParams);
     unique_ptr<Component> clone() const override { return make_unique<Diode>(*this); }
     void print() const override;
-    void stamp(MatrixXd& A, VectorXd& b, const VectorXd& x_prev_nr, int current_idx, double h, double t) override;
-    void stampAC(MatrixXcd& A, VectorXcd& b, int current_idx, double omega) const override;
+    void stamp(RealStamper& A, VectorXd& b, const VectorXd& x_prev_nr, int current_idx, double h, double t) override;
+    void stampAC(ComplexStamper& A, VectorXcd& b, int current_idx, double omega) const override;
     bool isNonLinear() const override { return true; }
+    bool isLimiting() const override { return limited; }
+    void setBypassTolerance(double reltol, double vntol) override { bypassReltol = reltol; bypassVntol = vntol; }
+    long evaluationCount() const override { return evaluations; }
+    long bypassCount() const override { return bypassed; }
+    void resetState() override { v_junction = 0.0; limited = false; evaluated = false; evaluations = 0; bypassed = 0; }
     string toNetlistString() const override;
+    DiodeModel getModel() const { return {modelName, Is, Vt, n, Vz}; }
     template<class Archive> void serialize(Archive & ar) { ar(cereal::base_class<Component>(this), CEREAL_NVP(modelName), CEREAL_NVP(Is), CEREAL_NVP(Vt), CEREAL_NVP(n), CEREAL_NVP(Vz)); }
 private:
     string modelName;
     double Is, Vt, n, Vz;
+    // Junction voltage the last stamp linearized around, and whether it had to be limited.
+    double v_junction = 0.0;
+    bool limited = false;
+    // Bypass: the linearization G_last/Ieq_last was taken at v_evaluated and is reused while
+    // the junction voltage stays within bypassReltol * |v| + bypassVntol of it.
+    double bypassReltol = 0.0, bypassVntol = 0.0;
+    double v_evaluated = 0.0, G_last = 0.0, Ieq_last = 0.0;
+    bool evaluated = false;
+    long evaluations = 0, bypassed = 0;
 };
 
 class VCVS : public Component {
@@ -265,14 +341,16 @@ public:
     VCVS(const string& name, int n1, int n2, int ctrl_n1, int ctrl_n2, double gain);
     unique_ptr<Component> clone() const override { return make_unique<VCVS>(*this); }
     void print() const override;
-    void stamp(MatrixXd& A, VectorXd& b, const VectorXd& x_prev_nr, int current_idx, double h, double t) override;
-    void stampAC(MatrixXcd& A, VectorXcd& b, int current_idx, double omega) const override;
+    void stamp(RealStamper& A, VectorXd& b, const VectorXd& x_prev_nr, int current_idx, double h, double t) override;
+    void stampAC(ComplexStamper& A, VectorXcd& b, int current_idx, double omega) const override;
     bool addsCurrentVariable() const override { return true; }
     int getCtrlNode1() const { return ctrlNode1; }
     int getCtrlNode2() const { return ctrlNode2; }
     void updateCtrlNodes(int oldNode, int newNode);
+    void remapCtrlNodes(const map<int, int>& nodeMap);
     string toNetlistString() const override;
     void setProperties(const map<string, double>& properties) override;
+    ParameterHandle parameterHandle(const string& property) override;
     map<string, double> getProperties() const override;
     string getDisplayValue() const override;
     template<class Archive> void serialize(Archive & ar) { ar(cereal::base_class<Component>(this), CEREAL_NVP(ctrlNode1), CEREAL_NVP(ctrlNode2), CEREAL_NVP(gain)); }
@@ -287,13 +365,15 @@ public:
     VCCS(const string& name, int n1, int n2, int ctrl_n1, int ctrl_n2, double gain);
     unique_ptr<Component> clone() const override { return make_unique<VCCS>(*this); }
     void print() const override;
-    void stamp(MatrixXd& A, VectorXd& b, const VectorXd& x_prev_nr, int current_idx, double h, double t) override;
-    void stampAC(MatrixXcd& A, VectorXcd& b, int current_idx, double omega) const override;
+    void stamp(RealStamper& A, VectorXd& b, const VectorXd& x_prev_nr, int current_idx, double h, double t) override;
+    void stampAC(ComplexStamper& A, VectorXcd& b, int current_idx, double omega) const override;
     int getCtrlNode1() const { return ctrlNode1; }
     int getCtrlNode2() const { return ctrlNode2; }
     void updateCtrlNodes(int oldNode, int newNode);
+    void remapCtrlNodes(const map<int, int>& nodeMap);
     string toNetlistString() const override;
     void setProperties(const map<string, double>& properties) override;
+    ParameterHandle parameterHandle(const string& property) override;
     map<string, double> getProperties() const override;
     string getDisplayValue() const override;
     template<class Archive> void serialize(Archive & ar) { ar(cereal::base_class<Component>(this), CEREAL_NVP(ctrlNode1), CEREAL_NVP(ctrlNode2), CEREAL_NVP(gain)); }
@@ -308,12 +388,13 @@ public:
     CCVS(const string& name, int n1, int n2, const string& vctrl_name, double gain);
     unique_ptr<Component> clone() const override { return make_unique<CCVS>(*this); }
     void print() const override;
-    void stamp(MatrixXd& A, VectorXd& b, const VectorXd& x_prev_nr, int current_idx, double h, double t) override;
-    void stampAC(MatrixXcd& A, VectorXcd& b, int current_idx, double omega) const override;
+    void stamp(RealStamper& A, VectorXd& b, const VectorXd& x_prev_nr, int current_idx, double h, double t) override;
+    void stampAC(ComplexStamper& A, VectorXcd& b, int current_idx, double omega) const override;
     bool addsCurrentVariable() const override { return true; }
     string getCtrlVName() const override { return ctrlVName; }
     string toNetlistString() const override;
     void setProperties(const map<string, double>& properties) override;
+    ParameterHandle parameterHandle(const string& property) override;
     map<string, double> getProperties() const override;
     string getDisplayValue() const override;
     template<class Archive> void serialize(Archive & ar) { ar(cereal::base_class<Component>(this), CEREAL_NVP(ctrlVName), CEREAL_NVP(gain)); }
@@ -328,11 +409,12 @@ public:
     CCCS(const string& name, int n1, int n2, const string& vctrl_name, double gain);
     unique_ptr<Component> clone() const override { return make_unique<CCCS>(*this); }
     void print() const override;
-    void stamp(MatrixXd& A, VectorXd& b, const VectorXd& x_prev_nr, int current_idx, double h, double t) override;
-    void stampAC(MatrixXcd& A, VectorXcd& b, int current_idx, double omega) const override;
+    void stamp(RealStamper& A, VectorXd& b, const VectorXd& x_prev_nr, int current_idx, double h, double t) override;
+    void stampAC(ComplexStamper& A, VectorXcd& b, int current_idx, double omega) const override;
     string getCtrlVName() const override { return ctrlVName; }
     string toNetlistString() const override;
     void setProperties(const map<string, double>& properties) override;
+    ParameterHandle parameterHandle(const string& property) override;
     map<string, double> getProperties() const override;
     string getDisplayValue() const override;
     template<class Archive> void serialize(Archive & ar) { ar(cereal::base_class<Component>(this), CEREAL_NVP(ctrlVName), CEREAL_NVP(gain)); }
@@ -347,8 +429,8 @@ public:
     Ground(const string& name, int n1);
     unique_ptr<Component> clone() const override { return make_unique<Ground>(*this); }
     void print() const override;
-    void stamp(MatrixXd& A, VectorXd& b, const VectorXd& x_prev_nr, int current_idx, double h, double t) override;
-    void stampAC(MatrixXcd& A, VectorXcd& b, int current_idx, double omega) const override;
+    void stamp(RealStamper& A, VectorXd& b, const VectorXd& x_prev_nr, int current_idx, double h, double t) override;
+    void stampAC(ComplexStamper& A, VectorXcd& b, int current_idx, double omega) const override;
     string toNetlistString() const override;
     template<class Archive> void serialize(Archive & ar) { ar(cereal::base_class<Component>(this)); }
 };
@@ -0,0 +1,132 @@
+#include "DeviceGroups.h"
+
+void DeviceGroups::Scatter::add(int target, int source, double sign) {
+    targets.push_back(target);
+    sources.push_back(source);
+    signs.push_back(sign);
+}
+
+void DeviceGroups::Scatter::apply(const double* source, double* target) const {
+    const size_t count = targets.size();
+    for (size_t k = 0; k < count; ++k) {
+        target[targets[k]] += signs[k] * source[sources[k]];
+    }
+}
+
+// The entries mirror the stamp() of each device type, including which ones a grounded
+// terminal drops, so they land on the slots the recorded stamp pass created.
+void DeviceGroups::build(const vector<unique_ptr<Component>>& components, const vector<int>& branchRows, const StampPlan& plan, vector<char>& grouped) {
+    *this = DeviceGroups();
+    grouped.assign(components.size(), 0);
+    for (size_t i = 0; i < components.size(); ++i) {
+        Component* comp = components[i].get();
+        int n1 = comp->getNode(0) - 1;
+        int n2 = comp->getNode(1) - 1;
+        if (dynamic_cast<Resistor*>(comp)) {
+            int device = static_cast<int>(conductances.size());
+            conductances.push_back(1.0 / comp->parameterHandle("Resistance").get());
+            if (n1 >= 0) conductanceEntries.add(plan.slotOf(n1, n1), device, 1.0);
+            if (n2 >= 0) conductanceEntries.add(plan.slotOf(n2, n2), device, 1.0);
+            if (n1 >= 0 && n2 >= 0) {
+                conductanceEntries.add(plan.slotOf(n1, n2), device, -1.0);
+                conductanceEntries.add(plan.slotOf(n2, n1), device, -1.0);
+            }
+        } else if (auto vccs = dynamic_cast<VCCS*>(comp)) {
+            int device = static_cast<int>(conductances.size());
+            conductances.push_back(comp->parameterHandle("Gain").get());
+            int cn1 = vccs->getCtrlNode1() - 1;
+            int cn2 = vccs->getCtrlNode2() - 1;
+            if (n1 >= 0) {
+                if (cn1 >= 0) conductanceEntries.add(plan.slotOf(n1, cn1), device, 1.0);
+                if (cn2 >= 0) conductanceEntries.add(plan.slotOf(n1, cn2), device, -1.0);
+            }
+            if (n2 >= 0) {
+                if (cn1 >= 0) conductanceEntries.add(plan.slotOf(n2, cn1), device, -1.0);
+                if (cn2 >= 0) conductanceEntries.add(plan.slotOf(n2, cn2), device, 1.0);
+            }
+        } else if (auto cap = dynamic_cast<Capacitor*>(comp)) {
+            int slot = cap->stateSlot();
+            if (slot < 0) continue;
+            if (n1 >= 0) companionEntries.add(plan.slotOf(n1, n1), slot, 1.0);
+            if (n2 >= 0) companionEntries.add(plan.slotOf(n2, n2), slot, 1.0);
+            if (n1 >= 0 && n2 >= 0) {
+                companionEntries.add(plan.slotOf(n1, n2), slot, -1.0);
+                companionEntries.add(plan.slotOf(n2, n1), slot, -1.0);
+            }
+            if (n1 >= 0) companionSources.add(n1, slot, 1.0);
+            if (n2 >= 0) companionSources.add(n2, slot, -1.0);
+        } else if (auto ind = dynamic_cast<Inductor*>(comp)) {
+            int slot = ind->stateSlot();
+            if (slot < 0) continue;
+            int branch = branchRows[i];
+            if (n1 >= 0) {
+                incidenceSlots.push_back(plan.slotOf(branch, n1));
+                incidenceValues.push_back(1.0);
+                incidenceSlots.push_back(plan.slotOf(n1, branch));
+                incidenceValues.push_back(1.0);
+            }
+            if (n2 >= 0) {
+                incidenceSlots.push_back(plan.slotOf(branch, n2));
+                incidenceValues.push_back(-1.0);
+                incidenceSlots.push_back(plan.slotOf(n2, branch));
+                incidenceValues.push_back(-1.0);
+            }
+            // Branch equation v - R_eq * i = V_eq with R_eq = g_eq and V_eq = -I_eq.
+            companionEntries.add(plan.slotOf(branch, branch), slot, -1.0);
+            companionSources.add(branch, slot, -1.0);
+        } else if (auto diode = dynamic_cast<Diode*>(comp)) {
+            int device = diodes.add(diode->getModel());
+            anodeRows.push_back(n1);
+            cathodeRows.push_back(n2);
+            if (n1 >= 0) diodeEntries.add(plan.slotOf(n1, n1), device, 1.0);
+            if (n2 >= 0) diodeEntries.add(plan.slotOf(n2, n2), device, 1.0);
+            if (n1 >= 0 && n2 >= 0) {
+                diodeEntries.add(plan.slotOf(n1, n2), device, -1.0);
+                diodeEntries.add(plan.slotOf(n2, n1), device, -1.0);
+            }
+            if (n1 >= 0) diodeSources.add(n1, device, -1.0);
+            if (n2 >= 0) diodeSources.add(n2, device, 1.0);
+        } else {
+            continue;
+        }
+        grouped[i] = 1;
+    }
+}
+
+void DeviceGroups::stampStatic(StampPlan& plan) const {
+    double* values = plan.valueData();
+    conductanceEntries.apply(conductances.data(), values);
+    for (size_t k = 0; k < incidenceSlots.size(); ++k) {
+        values[incidenceSlots[k]] += incidenceValues[k];
+    }
+}
+
+void DeviceGroups::evaluateCompanions(const ReactiveState& state, double h) {
+    g_eq.resize(state.size());
+    I_eq.resize(state.size());
+    state.companions(h, g_eq.data(), I_eq.data());
+}
+
+void DeviceGroups::stampCompanions(StampPlan& plan, const ReactiveState& state, double h) {
+    evaluateCompanions(state, h);
+    companionEntries.apply(g_eq.data(), plan.valueData());
+}
+
+void DeviceGroups::stampCompanionRhs(VectorXd& b, const ReactiveState& state, double h) {
+    evaluateCompanions(state, h);
+    companionSources.apply(I_eq.data(), b.data());
+}
+
+void DeviceGroups::stampDiodes(StampPlan& plan, VectorXd& b, const VectorXd& x) {
+    const int count = diodes.size();
+    if (count == 0) return;
+    junctionVoltages.resize(count);
+    for (int k = 0; k < count; ++k) {
+        double v1 = anodeRows[k] >= 0 ? x(anodeRows[k]) : 0.0;
+        double v2 = cathodeRows[k] >= 0 ? x(cathodeRows[k]) : 0.0;
+        junctionVoltages[k] = v1 - v2;
+    }
+    diodes.evaluate(junctionVoltages.data());
+    diodeEntries.apply(diodes.conductances(), plan.valueData());
+    diodeSources.apply(diodes.currents(), b.data());
+}
@@ -0,0 +1,65 @@
+#ifndef DEVICEGROUPS_H
+#define DEVICEGROUPS_H
+
+#include <vector>
+#include <memory>
+#include <Eigen/Dense>
+#include "Component.h"
+#include "StampPlan.h"
+#include "ReactiveState.h"
+#include "DiodeArray.h"
+
+using namespace std;
+using namespace Eigen;
+
+// Compiled simulation view of the resistors, VCCSs, capacitors, inductors and diodes of an
+// analysed circuit. Devices of one type are kept as flat arrays (values, matrix slots, rows)
+// and each group is stamped by one non-virtual loop, so a large R or C array costs an indexed
+// add per matrix entry instead of a virtual stamp() per device. The view reuses the slots of the
+// compiled StampPlan; every other component still stamps through the Component interface.
+class DeviceGroups {
+public:
+    // Takes over the supported devices of components, setting grouped[i] for each of them.
+    void build(const vector<unique_ptr<Component>>& components, const vector<int>& branchRows, const StampPlan& plan, vector<char>& grouped);
+    // Adds the step-independent entries: resistor conductances, VCCS gains, inductor incidence.
+    void stampStatic(StampPlan& plan) const;
+    // Adds the capacitor and inductor companion conductances for step h.
+    void stampCompanions(StampPlan& plan, const ReactiveState& state, double h);
+    // Adds the capacitor and inductor companion sources for step h to b.
+    void stampCompanionRhs(VectorXd& b, const ReactiveState& state, double h);
+    // Linearizes all diodes at x in one batch and adds their stamps.
+    void stampDiodes(StampPlan& plan, VectorXd& b, const VectorXd& x);
+    void resetDiodes(double reltol, double vntol) { diodes.reset(reltol, vntol); }
+    const DiodeArray& getDiodes() const { return diodes; }
+
+private:
+    // Entry k adds signs[k] * source[sources[k]] to target[targets[k]].
+    struct Scatter {
+        vector<int> targets;
+        vector<int> sources;
+        vector<double> signs;
+        void add(int target, int source, double sign);
+        void apply(const double* source, double* target) const;
+    };
+    // Resistor conductances and VCCS transconductances, one per device.
+    vector<double> conductances;
+    Scatter conductanceEntries;
+    // The +-1 branch incidence of the inductors.
+    vector<int> incidenceSlots;
+    vector<double> incidenceValues;
+    // Capacitors and inductors, sourced by ReactiveState slot.
+    Scatter companionEntries;
+    Scatter companionSources;
+    vector<double> g_eq;
+    vector<double> I_eq;
+    // Diodes: node rows (-1 for ground) to gather the junction voltages from.
+    DiodeArray diodes;
+    vector<int> anodeRows;
+    vector<int> cathodeRows;
+    vector<double> junctionVoltages;
+    Scatter diodeEntries;
+    Scatter diodeSources;
+    void evaluateCompanions(const ReactiveState& state, double h);
+};
+
+#endif
@@ -0,0 +1,106 @@
+#include "DiodeArray.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+// One clone per ISA, picked at load time from the CPU; the build has to allow if-conversion of
+// the clamp (-fno-trapping-math) and honour the simd pragma (-fopenmp-simd), see CMakeLists.txt.
+#if defined(__GNUC__) && defined(__x86_64__) && defined(__ELF__)
+__attribute__((target_clones("avx512f", "avx2", "default")))
+#endif
+void batchExp(const double* x, double* y, int count) {
+    const double log2e = 1.4426950408889634;
+    const double ln2Hi = 6.93147180369123816490e-01;
+    const double ln2Lo = 1.90821492927058770002e-10;
+    // Adding 1.5 * 2^52 leaves an integer-valued double's value in the low mantissa bits.
+    const double shifter = 6755399441055744.0;
+    uint64_t shifterBits;
+    memcpy(&shifterBits, &shifter, sizeof(shifterBits));
+#pragma omp simd
+    for (int k = 0; k < count; ++k) {
+        // Selects rather than std::min/max, which the vectorizer sees as control flow.
+        double v = x[k] < -708.0 ? -708.0 : x[k];
+        v = v > 708.0 ? 708.0 : v;
+        double n = (v * log2e + shifter) - shifter;
+        double r = (v - n * ln2Hi) - n * ln2Lo;
+        // Taylor series of exp(r) for |r| <= ln2 / 2, within an ulp in double precision.
+        double p = 1.0 / 479001600.0;
+        p = p * r + 1.0 / 39916800.0;
+        p = p * r + 1.0 / 3628800.0;
+        p = p * r + 1.0 / 362880.0;
+        p = p * r + 1.0 / 40320.0;
+        p = p * r + 1.0 / 5040.0;
+        p = p * r + 1.0 / 720.0;
+        p = p * r + 1.0 / 120.0;
+        p = p * r + 1.0 / 24.0;
+        p = p * r + 1.0 / 6.0;
+        p = p * r + 0.5;
+        p = p * r + 1.0;
+        p = p * r + 1.0;
+        double shifted = n + shifter;
+        uint64_t bits;
+        memcpy(&bits, &shifted, sizeof(bits));
+        bits = (bits - shifterBits + 1023) << 52;
+        double scale;
+        memcpy(&scale, &bits, sizeof(scale));
+        y[k] = p * scale;
+    }
+}
+
+int DiodeArray::add(const DiodeModel& model) {
+    double diodeNVt = model.n * model.Vt;
+    Is.push_back(model.Is);
+    nVt.push_back(diodeNVt);
+    Vcrit.push_back(diodeCriticalVoltage(diodeNVt, model.Is));
+    Vz.push_back(model.Vz);
+    vJunction.push_back(0.0);
+    vEvaluated.push_back(0.0);
+    G.push_back(0.0);
+    Ieq.push_back(0.0);
+    evaluated.push_back(0);
+    return size() - 1;
+}
+
+void DiodeArray::reset(double reltol, double vntol) {
+    fill(vJunction.begin(), vJunction.end(), 0.0);
+    fill(evaluated.begin(), evaluated.end(), 0);
+    bypassReltol = reltol;
+    bypassVntol = vntol;
+    limiting = false;
+    evaluations = 0;
+    bypassed = 0;
+}
+
+void DiodeArray::evaluate(const double* vd) {
+    const int count = size();
+    limiting = false;
+    pending.clear();
+    expArgs.clear();
+    for (int k = 0; k < count; ++k) {
+        evaluations++;
+        DiodeStep step = diodeStep(vd[k], vJunction[k], vEvaluated[k], evaluated[k], nVt[k], Vcrit[k], Vz[k], bypassReltol, bypassVntol);
+        if (step.bypassed) {
+            bypassed++;
+            continue;
+        }
+        vJunction[k] = step.vJunction;
+        vEvaluated[k] = step.vEvaluated;
+        evaluated[k] = step.evaluated;
+        limiting = limiting || step.limited;
+        if (step.needsExp) {
+            pending.push_back(k);
+            expArgs.push_back(vJunction[k] / nVt[k]);
+        } else {
+            G[k] = step.G;
+            Ieq[k] = step.Ieq;
+        }
+    }
+
+    const int exps = static_cast<int>(pending.size());
+    expValues.resize(exps);
+    batchExp(expArgs.data(), expValues.data(), exps);
+    for (int j = 0; j < exps; ++j) {
+        const int k = pending[j];
+        diodeExpLinearization(Is[k], nVt[k], vJunction[k], expValues[j], G[k], Ieq[k]);
+    }
+}
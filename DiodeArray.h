@@ -0,0 +1,47 @@
+#ifndef DIODEARRAY_H
+#define DIODEARRAY_H
+
+#include <vector>
+#include "DiodeModel.h"
+
+using namespace std;
+
+// exp() of count values in one loop of selects and arithmetic (Cody-Waite reduction and a
+// polynomial). On x86-64 ELF builds with GCC or Clang it is compiled as AVX-512 and AVX2
+// vector clones plus a scalar default, dispatched at run time; elsewhere it is scalar code.
+// Arguments are clamped to +-708, which keeps every result finite and normal.
+void batchExp(const double* x, double* y, int count);
+
+// Junction diodes in structure-of-arrays form, linearized as a batch with the model Diode::stamp
+// uses (diodeStep and diodeExpLinearization in DiodeModel.h). One evaluation runs diodeStep over
+// every diode, a single batchExp() over the ones that need the exponential, and a pass that
+// forms their conductance G and companion current Ieq.
+class DiodeArray {
+public:
+    int add(const DiodeModel& model);
+    int size() const { return static_cast<int>(Is.size()); }
+    // Forgets the Newton state and counters and sets the bypass tolerance, as Diode::resetState
+    // and Diode::setBypassTolerance do; vntol <= 0 turns bypass off.
+    void reset(double reltol, double vntol);
+    // Linearizes diode k at junction voltage vd[k], so that i = G[k] * v + Ieq[k].
+    void evaluate(const double* vd);
+    const double* conductances() const { return G.data(); }
+    const double* currents() const { return Ieq.data(); }
+    // True when the last evaluation limited any junction voltage.
+    bool isLimiting() const { return limiting; }
+    long evaluationCount() const { return evaluations; }
+    long bypassCount() const { return bypassed; }
+
+private:
+    vector<double> Is, nVt, Vcrit, Vz;
+    vector<double> vJunction, vEvaluated, G, Ieq;
+    vector<char> evaluated;
+    double bypassReltol = 0.0, bypassVntol = 0.0;
+    bool limiting = false;
+    long evaluations = 0, bypassed = 0;
+    // The diodes of the current evaluation that need exp(), and its argument and result.
+    vector<int> pending;
+    vector<double> expArgs, expValues;
+};
+
+#endif
@@ -2,6 +2,8 @@
 #define DIODEMODEL_H
 
 #include <string>
+#include <cmath>
+#include <algorithm>
 
 using namespace std;
 
@@ -13,4 +15,68 @@ struct DiodeModel {
     double Vz = -1.0;
 };
 
+// Junction voltage above which the diode current grows fast enough to need limiting.
+inline double diodeCriticalVoltage(double nVt, double Is) {
+    return nVt * std::log(nVt / (std::sqrt(2.0) * Is));
+}
+
+// SPICE pnjlim: above the critical voltage a forward step is compressed to a logarithmic one
+// from the last junction voltage, so exp() never sees a raw Newton overshoot.
+inline double limitJunctionVoltage(double v_new, double v_old, double nVt, double Vcrit, bool& limited) {
+    limited = false;
+    if (v_new > Vcrit && std::abs(v_new - v_old) > 2.0 * nVt) {
+        limited = true;
+        if (v_old > 0) {
+            double arg = 1.0 + (v_new - v_old) / nVt;
+            return (arg > 0) ? v_old + nVt * std::log(arg) : Vcrit;
+        }
+        return nVt * std::log(v_new / nVt);
+    }
+    return v_new;
+}
+
+// Outcome of one Newton linearization of a junction diode at junction voltage Vd. Unless it
+// is bypassed, the caller stores vJunction, vEvaluated and evaluated as the new junction
+// state, and takes G and Ieq from here (breakdown) or from diodeExpLinearization (needsExp).
+struct DiodeStep {
+    bool bypassed = false;
+    bool needsExp = false;
+    bool limited = false;
+    double vJunction = 0.0;
+    double vEvaluated = 0.0;
+    bool evaluated = false;
+    double G = 0.0;
+    double Ieq = 0.0;
+};
+
+// The diode model shared by Diode::stamp and DiodeArray, all but the exponential: bypass of a
+// quiescent junction (within reltol * |v| + vntol of the last evaluation, vntol <= 0 turns it
+// off), the zener breakdown conductance below -Vz, and pnjlim otherwise.
+inline DiodeStep diodeStep(double Vd, double vJunction, double vEvaluated, bool evaluated, double nVt, double Vcrit, double Vz, double reltol, double vntol) {
+    DiodeStep step;
+    if (vntol > 0 && evaluated && std::abs(Vd - vEvaluated) < reltol * max(std::abs(Vd), std::abs(vEvaluated)) + vntol) {
+        step.bypassed = true;
+    } else if (Vz > 0 && Vd < -Vz) {
+        const double Gz = 100.0;
+        step.G = Gz;
+        step.Ieq = Gz * Vz;
+        step.vJunction = Vd;
+        step.vEvaluated = Vd;
+        step.evaluated = true;
+    } else {
+        step.vJunction = limitJunctionVoltage(Vd, vJunction, nVt, Vcrit, step.limited);
+        step.needsExp = true;
+        // A limited evaluation is linearized away from Vd, so it cannot be bypassed from.
+        step.vEvaluated = Vd;
+        step.evaluated = !step.limited;
+    }
+    return step;
+}
+
+// Forward-region linearization i = G * v + Ieq at junction voltage v, given e = exp(v / nVt).
+inline void diodeExpLinearization(double Is, double nVt, double v, double e, double& G, double& Ieq) {
+    G = (Is / nVt) * e;
+    Ieq = Is * (e - 1.0) - G * v;
+}
+
 #endif
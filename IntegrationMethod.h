@@ -0,0 +1,55 @@
+#ifndef INTEGRATIONMETHOD_H
+#define INTEGRATIONMETHOD_H
+
+#include <string>
+#include <stdexcept>
+#include <algorithm>
+#include <cctype>
+
+using namespace std;
+
+// Companion model used for capacitors and inductors in transient analysis.
+enum class IntegrationMethod {
+    BackwardEuler,
+    Trapezoidal,
+    Gear2
+};
+
+inline IntegrationMethod parseIntegrationMethod(const string& name) {
+    string key = name;
+    transform(key.begin(), key.end(), key.begin(), [](unsigned char c){ return tolower(c); });
+    if (key == "be" || key == "euler") return IntegrationMethod::BackwardEuler;
+    if (key == "trap" || key == "trapezoidal") return IntegrationMethod::Trapezoidal;
+    if (key == "gear" || key == "gear2" || key == "bdf2") return IntegrationMethod::Gear2;
+    throw invalid_argument("Unknown integration method '" + name + "'. Expected be, trap or gear2.");
+}
+
+inline string integrationMethodName(IntegrationMethod method) {
+    switch (method) {
+        case IntegrationMethod::BackwardEuler: return "be";
+        case IntegrationMethod::Trapezoidal: return "trap";
+        case IntegrationMethod::Gear2: return "gear2";
+    }
+    return "be";
+}
+
+// Order of accuracy; the truncation error of a step h scales with h^(order + 1).
+inline int integrationOrder(IntegrationMethod method) {
+    return method == IntegrationMethod::BackwardEuler ? 1 : 2;
+}
+
+// Coefficients of the derivative approximation x'(t+h) ~ a0*x(t+h) + a1*x(t) + a2*x(t-h_prev).
+// Gear-2 uses the variable-step BDF2 form, so the previous step length enters the companion.
+struct IntegrationCoefficients {
+    double a0, a1, a2;
+};
+
+inline IntegrationCoefficients gear2Coefficients(double h, double h_prev) {
+    return {
+        (2.0 * h + h_prev) / (h * (h + h_prev)),
+        -(h + h_prev) / (h * h_prev),
+        h / (h_prev * (h + h_prev))
+    };
+}
+
+#endif
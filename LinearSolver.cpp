@@ -0,0 +1,300 @@
+#include "LinearSolver.h"
+#include <stdexcept>
+#include <algorithm>
+#include <cctype>
+#include <queue>
+#include <Eigen/LU>
+#include <Eigen/SparseLU>
+#include <Eigen/SparseQR>
+#include <Eigen/IterativeLinearSolvers>
+
+LinearSolverType parseLinearSolverType(const string& name) {
+    string key = name;
+    transform(key.begin(), key.end(), key.begin(), [](unsigned char c){ return tolower(c); });
+    if (key == "auto") return LinearSolverType::Auto;
+    if (key == "lu" || key == "denselu") return LinearSolverType::DenseLU;
+    if (key == "fullpivlu") return LinearSolverType::DenseFullPivLU;
+    if (key == "sparselu") return LinearSolverType::SparseLU;
+    if (key == "sparseqr") return LinearSolverType::SparseQR;
+    if (key == "bicgstab" || key == "iterative") return LinearSolverType::Iterative;
+    throw invalid_argument("Unknown linear solver '" + name + "'. Expected auto, lu, fullpivlu, sparselu, sparseqr or bicgstab.");
+}
+
+string linearSolverTypeName(LinearSolverType type) {
+    switch (type) {
+        case LinearSolverType::Auto: return "auto";
+        case LinearSolverType::DenseLU: return "lu";
+        case LinearSolverType::DenseFullPivLU: return "fullpivlu";
+        case LinearSolverType::SparseLU: return "sparselu";
+        case LinearSolverType::SparseQR: return "sparseqr";
+        case LinearSolverType::Iterative: return "bicgstab";
+    }
+    return "auto";
+}
+
+LinearSolverType resolveLinearSolverType(LinearSolverType type, int size, long nonZeros) {
+    if (type != LinearSolverType::Auto) return type;
+    if (size < AUTO_SPARSE_THRESHOLD) return LinearSolverType::DenseLU;
+    double density = static_cast<double>(nonZeros) / (static_cast<double>(size) * size);
+    if (density > AUTO_DENSE_FILL_RATIO && size <= AUTO_DENSE_MAX_SIZE) return LinearSolverType::DenseLU;
+    return LinearSolverType::SparseLU;
+}
+
+bool isSparseSolverType(LinearSolverType type) {
+    return type == LinearSolverType::SparseLU || type == LinearSolverType::SparseQR || type == LinearSolverType::Iterative;
+}
+
+MatrixOrdering parseMatrixOrdering(const string& name) {
+    string key = name;
+    transform(key.begin(), key.end(), key.begin(), [](unsigned char c){ return tolower(c); });
+    if (key == "colamd") return MatrixOrdering::COLAMD;
+    if (key == "amd") return MatrixOrdering::AMD;
+    if (key == "rcm") return MatrixOrdering::RCM;
+    if (key == "natural" || key == "none") return MatrixOrdering::Natural;
+    throw invalid_argument("Unknown matrix ordering '" + name + "'. Expected colamd, amd, rcm or natural.");
+}
+
+string matrixOrderingName(MatrixOrdering ordering) {
+    switch (ordering) {
+        case MatrixOrdering::COLAMD: return "colamd";
+        case MatrixOrdering::AMD: return "amd";
+        case MatrixOrdering::RCM: return "rcm";
+        case MatrixOrdering::Natural: return "natural";
+    }
+    return "colamd";
+}
+
+namespace {
+
+// Reverse Cuthill-McKee on the pattern of A + A^T, as an ordering functor for Eigen's sparse
+// solvers. Each connected part is walked breadth-first from its lowest-degree node, visiting
+// neighbours by increasing degree, and the visit order is reversed. This keeps the bandwidth
+// small, which bounds fill on ladder- and mesh-like networks.
+template<typename StorageIndex>
+class RCMOrdering {
+public:
+    typedef PermutationMatrix<Dynamic, Dynamic, StorageIndex> PermutationType;
+
+    template<typename MatrixType>
+    void operator()(const MatrixType& mat, PermutationType& perm) {
+        const Index n = mat.cols();
+        vector<vector<StorageIndex>> adjacency(n);
+        for (Index col = 0; col < mat.outerSize(); ++col) {
+            for (typename MatrixType::InnerIterator it(mat, col); it; ++it) {
+                if (it.row() == col) continue;
+                adjacency[it.row()].push_back(static_cast<StorageIndex>(col));
+                adjacency[col].push_back(static_cast<StorageIndex>(it.row()));
+            }
+        }
+        for (auto& neighbours : adjacency) {
+            sort(neighbours.begin(), neighbours.end());
+            neighbours.erase(unique(neighbours.begin(), neighbours.end()), neighbours.end());
+        }
+        auto byDegree = [&](StorageIndex a, StorageIndex b) { return adjacency[a].size() < adjacency[b].size(); };
+
+        vector<StorageIndex> order;
+        order.reserve(n);
+        vector<bool> visited(n, false);
+        vector<StorageIndex> byMinDegree(n);
+        for (Index i = 0; i < n; ++i) byMinDegree[i] = static_cast<StorageIndex>(i);
+        stable_sort(byMinDegree.begin(), byMinDegree.end(), byDegree);
+
+        for (StorageIndex start : byMinDegree) {
+            if (visited[start]) continue;
+            queue<StorageIndex> frontier;
+            frontier.push(start);
+            visited[start] = true;
+            while (!frontier.empty()) {
+                StorageIndex node = frontier.front();
+                frontier.pop();
+                order.push_back(node);
+                vector<StorageIndex> next;
+                for (StorageIndex neighbour : adjacency[node]) {
+                    if (!visited[neighbour]) {
+                        visited[neighbour] = true;
+                        next.push_back(neighbour);
+                    }
+                }
+                stable_sort(next.begin(), next.end(), byDegree);
+                for (StorageIndex neighbour : next) frontier.push(neighbour);
+            }
+        }
+
+        // perm maps an original column to its new position, the convention of COLAMDOrdering.
+        perm.resize(n);
+        for (Index k = 0; k < n; ++k) {
+            perm.indices()(order[n - 1 - k]) = static_cast<StorageIndex>(k);
+        }
+    }
+};
+
+// Partial pivoting does not detect singular matrices, and a zero pivot turns the solution into
+// NaN. When the smallest pivot is negligible next to the largest entry of A, the system is solved
+// with rank-revealing column-pivoted QR instead, as the sparse LU falls back to sparse QR.
+template<typename Scalar>
+class DenseLUSolver : public LinearSolver<Scalar> {
+public:
+    using typename LinearSolver<Scalar>::Vector;
+    using typename LinearSolver<Scalar>::DenseMatrix;
+    LinearSolverType type() const override { return LinearSolverType::DenseLU; }
+    bool isSparse() const override { return false; }
+    Vector solve(const Vector& b) const override { return singular ? Vector(qr.solve(b)) : Vector(lu.solve(b)); }
+    void solveInto(const Vector& b, Vector& x) const override {
+        if (singular) x = qr.solve(b);
+        else x = lu.solve(b);
+    }
+protected:
+    void factorizeDense(const DenseMatrix& A) override {
+        using Real = typename NumTraits<Scalar>::Real;
+        lu.compute(A);
+        singular = false;
+        if (A.size() == 0) return;
+        const Real tiny = NumTraits<Scalar>::epsilon() * A.rows() * A.cwiseAbs().maxCoeff();
+        singular = !(lu.matrixLU().diagonal().cwiseAbs().minCoeff() > tiny);
+        if (singular) qr.compute(A);
+    }
+private:
+    PartialPivLU<DenseMatrix> lu;
+    ColPivHouseholderQR<DenseMatrix> qr;
+    bool singular = false;
+};
+
+template<typename Scalar>
+class DenseFullPivLUSolver : public LinearSolver<Scalar> {
+public:
+    using typename LinearSolver<Scalar>::Vector;
+    using typename LinearSolver<Scalar>::DenseMatrix;
+    LinearSolverType type() const override { return LinearSolverType::DenseFullPivLU; }
+    bool isSparse() const override { return false; }
+    Vector solve(const Vector& b) const override { return lu.solve(b); }
+protected:
+    void factorizeDense(const DenseMatrix& A) override { lu.compute(A); }
+private:
+    FullPivLU<DenseMatrix> lu;
+};
+
+template<typename Scalar, typename Ordering>
+class SparseQRSolver : public LinearSolver<Scalar> {
+public:
+    using typename LinearSolver<Scalar>::Vector;
+    using typename LinearSolver<Scalar>::SparseMatrixType;
+    LinearSolverType type() const override { return LinearSolverType::SparseQR; }
+    bool isSparse() const override { return true; }
+    Vector solve(const Vector& b) const override { return qr.solve(b); }
+    double fillRatio() const override { return static_cast<double>(qr.matrixR().nonZeros()) / inputNonZeros; }
+protected:
+    void factorizeSparse(const SparseMatrixType& A) override {
+        SparseMatrixType compressed = A;
+        compressed.makeCompressed();
+        inputNonZeros = max<Index>(compressed.nonZeros(), 1);
+        qr.compute(compressed);
+        if (qr.info() != Success) {
+            throw runtime_error("Sparse QR factorization failed.");
+        }
+    }
+private:
+    Eigen::SparseQR<SparseMatrixType, Ordering> qr;
+    Index inputNonZeros = 1;
+};
+
+// Falls back to sparse QR when LU hits a structurally or numerically singular matrix, e.g.
+// a node that only connects to capacitors in a DC solve.
+template<typename Scalar, typename Ordering>
+class SparseLUSolver : public LinearSolver<Scalar> {
+public:
+    using typename LinearSolver<Scalar>::Vector;
+    using typename LinearSolver<Scalar>::SparseMatrixType;
+    LinearSolverType type() const override { return LinearSolverType::SparseLU; }
+    bool isSparse() const override { return true; }
+    Vector solve(const Vector& b) const override { return fallback ? fallback->solve(b) : Vector(lu.solve(b)); }
+    void solveInto(const Vector& b, Vector& x) const override {
+        if (fallback) fallback->solveInto(b, x);
+        else x = lu.solve(b);
+    }
+    double fillRatio() const override {
+        if (fallback) return fallback->fillRatio();
+        return static_cast<double>(lu.nnzL() + lu.nnzU()) / inputNonZeros;
+    }
+protected:
+    void factorizeSparse(const SparseMatrixType& A) override {
+        fallback.reset();
+        inputNonZeros = max<Index>(A.nonZeros(), 1);
+        lu.compute(A);
+        analyzed = (lu.info() == Success);
+        if (!analyzed) {
+            fallback = make_unique<SparseQRSolver<Scalar, Ordering>>();
+            fallback->factorize(A);
+        }
+    }
+    void refactorizeSparse(const SparseMatrixType& A) override {
+        if (!analyzed) {
+            factorizeSparse(A);
+            return;
+        }
+        lu.factorize(A);
+        if (lu.info() != Success) factorizeSparse(A);
+    }
+private:
+    Eigen::SparseLU<SparseMatrixType, Ordering> lu;
+    bool analyzed = false;
+    Index inputNonZeros = 1;
+    unique_ptr<LinearSolver<Scalar>> fallback;
+};
+
+// BiCGSTAB preconditioned with an incomplete LU; MNA matrices are not symmetric, so CG is out.
+template<typename Scalar>
+class IterativeSolver : public LinearSolver<Scalar> {
+public:
+    using typename LinearSolver<Scalar>::Vector;
+    using typename LinearSolver<Scalar>::SparseMatrixType;
+    IterativeSolver() { solver.setTolerance(1e-12); }
+    LinearSolverType type() const override { return LinearSolverType::Iterative; }
+    bool isSparse() const override { return true; }
+    Vector solve(const Vector& b) const override {
+        Vector x = solver.solve(b);
+        if (solver.info() != Success) {
+            throw runtime_error("Iterative solver (BiCGSTAB) did not converge.");
+        }
+        return x;
+    }
+protected:
+    void factorizeSparse(const SparseMatrixType& A) override {
+        matrix = A;
+        solver.compute(matrix);
+        if (solver.info() != Success) {
+            throw runtime_error("Incomplete LU preconditioner failed for the iterative solver.");
+        }
+    }
+private:
+    SparseMatrixType matrix;
+    BiCGSTAB<SparseMatrixType, IncompleteLUT<Scalar>> solver;
+};
+
+template<typename Scalar, template<typename, typename> class Backend>
+unique_ptr<LinearSolver<Scalar>> makeOrderedSolver(MatrixOrdering ordering) {
+    switch (ordering) {
+        case MatrixOrdering::COLAMD: return make_unique<Backend<Scalar, COLAMDOrdering<int>>>();
+        case MatrixOrdering::AMD: return make_unique<Backend<Scalar, AMDOrdering<int>>>();
+        case MatrixOrdering::RCM: return make_unique<Backend<Scalar, RCMOrdering<int>>>();
+        case MatrixOrdering::Natural: return make_unique<Backend<Scalar, NaturalOrdering<int>>>();
+    }
+    return make_unique<Backend<Scalar, COLAMDOrdering<int>>>();
+}
+
+}
+
+template<typename Scalar>
+unique_ptr<LinearSolver<Scalar>> makeLinearSolver(LinearSolverType type, MatrixOrdering ordering) {
+    switch (type) {
+        case LinearSolverType::DenseLU: return make_unique<DenseLUSolver<Scalar>>();
+        case LinearSolverType::DenseFullPivLU: return make_unique<DenseFullPivLUSolver<Scalar>>();
+        case LinearSolverType::SparseLU: return makeOrderedSolver<Scalar, SparseLUSolver>(ordering);
+        case LinearSolverType::SparseQR: return makeOrderedSolver<Scalar, SparseQRSolver>(ordering);
+        case LinearSolverType::Iterative: return make_unique<IterativeSolver<Scalar>>();
+        case LinearSolverType::Auto: break;
+    }
+    throw logic_error("makeLinearSolver requires a resolved solver type; call resolveLinearSolverType first.");
+}
+
+template unique_ptr<LinearSolver<double>> makeLinearSolver<double>(LinearSolverType type, MatrixOrdering ordering);
+template unique_ptr<LinearSolver<complex<double>>> makeLinearSolver<complex<double>>(LinearSolverType type, MatrixOrdering ordering);
@@ -0,0 +1,81 @@
+#ifndef LINEARSOLVER_H
+#define LINEARSOLVER_H
+
+#include <string>
+#include <memory>
+#include <complex>
+#include <Eigen/Dense>
+#include <Eigen/Sparse>
+
+using namespace std;
+using namespace Eigen;
+
+enum class LinearSolverType {
+    Auto,
+    DenseLU,
+    DenseFullPivLU,
+    SparseLU,
+    SparseQR,
+    Iterative
+};
+
+// Fill-reducing permutation applied to the columns of sparse systems before factorization.
+// Node numbers come from the netlist or the schematic, so the natural order is arbitrary.
+enum class MatrixOrdering {
+    COLAMD,
+    AMD,
+    RCM,
+    Natural
+};
+
+// Systems with at least this many unknowns are sent to a sparse backend by the auto mode.
+constexpr int AUTO_SPARSE_THRESHOLD = 150;
+// Above this fill density (nonzeros / n^2) the auto mode keeps moderately sized systems dense.
+constexpr double AUTO_DENSE_FILL_RATIO = 0.2;
+constexpr int AUTO_DENSE_MAX_SIZE = 2000;
+
+LinearSolverType parseLinearSolverType(const string& name);
+string linearSolverTypeName(LinearSolverType type);
+// Resolves Auto to a concrete backend from the system size and its number of nonzeros.
+LinearSolverType resolveLinearSolverType(LinearSolverType type, int size, long nonZeros);
+bool isSparseSolverType(LinearSolverType type);
+MatrixOrdering parseMatrixOrdering(const string& name);
+string matrixOrderingName(MatrixOrdering ordering);
+
+// Factorize-then-solve interface shared by the dense and sparse backends. isSparse() tells
+// the caller which matrix representation to assemble; passing the other one still works
+// but costs a conversion.
+template<typename Scalar>
+class LinearSolver {
+public:
+    using Vector = Matrix<Scalar, Dynamic, 1>;
+    using DenseMatrix = Matrix<Scalar, Dynamic, Dynamic>;
+    using SparseMatrixType = SparseMatrix<Scalar>;
+
+    virtual ~LinearSolver() = default;
+
+    virtual LinearSolverType type() const = 0;
+    virtual bool isSparse() const = 0;
+
+    void factorize(const DenseMatrix& A) { factorizeDense(A); }
+    void factorize(const SparseMatrixType& A) { factorizeSparse(A); }
+    // Factorizes a matrix with the same sparsity pattern as the previous factorize() call.
+    // Sparse LU keeps its symbolic analysis (ordering, elimination tree) and only redoes
+    // the numeric phase; the other backends fall back to a full factorization.
+    void refactorize(const SparseMatrixType& A) { refactorizeSparse(A); }
+    virtual Vector solve(const Vector& b) const = 0;
+    // Same as x = solve(b), but writes into x's storage where the backend allows.
+    virtual void solveInto(const Vector& b, Vector& x) const { x = solve(b); }
+    // Nonzeros in the computed factors over nonzeros in A; 0 when the backend has no sparse factors.
+    virtual double fillRatio() const { return 0.0; }
+
+protected:
+    virtual void factorizeDense(const DenseMatrix& A) { factorizeSparse(A.sparseView()); }
+    virtual void factorizeSparse(const SparseMatrixType& A) { factorizeDense(DenseMatrix(A)); }
+    virtual void refactorizeSparse(const SparseMatrixType& A) { factorizeSparse(A); }
+};
+
+template<typename Scalar>
+unique_ptr<LinearSolver<Scalar>> makeLinearSolver(LinearSolverType type, MatrixOrdering ordering = MatrixOrdering::COLAMD);
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef MNASTAMPER_H
+#define MNASTAMPER_H
+
+#include <vector>
+#include <complex>
+#include <Eigen/Dense>
+#include <Eigen/Sparse>
+
+using namespace std;
+using namespace Eigen;
+
+// Destination for the left-hand side of an MNA system. Components stamp through add()
+// and do not care whether the matrix is a dense MatrixX or a triplet list that is later
+// compressed into a SparseMatrix, so the same stamp code serves both assembly paths.
+// A default-constructed stamper discards the matrix entries; it is used to rebuild only
+// the right-hand side when the matrix has already been factorized. A slot stamper writes
+// straight into a flat value array at offsets precompiled by StampPlan.
+template<typename Scalar>
+class MNAStamper {
+public:
+    using DenseMatrix = Matrix<Scalar, Dynamic, Dynamic>;
+    using TripletList = vector<Triplet<Scalar>>;
+
+    explicit MNAStamper(DenseMatrix& dense) : dense(&dense) {}
+    explicit MNAStamper(TripletList& triplets) : triplets(&triplets) {}
+    MNAStamper(Scalar* values, const int* slots) : values(values), slot(slots) {}
+    MNAStamper() = default;
+
+    void add(int row, int col, Scalar value) {
+        if (slot) values[*slot++] += value;
+        else if (dense) (*dense)(row, col) += value;
+        else if (triplets) triplets->emplace_back(row, col, value);
+    }
+
+    bool isSparse() const { return triplets != nullptr; }
+    const int* nextSlot() const { return slot; }
+
+private:
+    Scalar* values = nullptr;
+    const int* slot = nullptr;
+    DenseMatrix* dense = nullptr;
+    TripletList* triplets = nullptr;
+};
+
+using RealStamper = MNAStamper<double>;
+using ComplexStamper = MNAStamper<complex<double>>;
+
+#endif
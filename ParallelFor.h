@@ -0,0 +1,57 @@
+#ifndef PARALLELFOR_H
+#define PARALLELFOR_H
+
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <exception>
+#include <algorithm>
+
+using namespace std;
+
+// Number of workers for `work` independent items; requested <= 0 means one per hardware thread.
+inline unsigned resolveThreadCount(int requested, size_t work) {
+    unsigned threads = requested > 0 ? static_cast<unsigned>(requested) : thread::hardware_concurrency();
+    if (threads == 0) threads = 1;
+    return static_cast<unsigned>(min<size_t>(threads, max<size_t>(work, 1)));
+}
+
+// Calls body(worker, index) for every index in [0, count) on `threads` workers. Indices are
+// handed out one at a time, so uneven items balance out; worker is in [0, threads) and lets
+// the caller keep per-worker scratch state. The first exception thrown by body stops the
+// remaining items and is rethrown on the calling thread.
+template<typename Body>
+void parallelFor(size_t count, unsigned threads, Body body) {
+    if (threads <= 1 || count <= 1) {
+        for (size_t i = 0; i < count; ++i) body(0u, i);
+        return;
+    }
+
+    atomic<size_t> next{0};
+    atomic<bool> failed{false};
+    exception_ptr error;
+    mutex errorMutex;
+
+    auto run = [&](unsigned worker) {
+        try {
+            for (size_t i = next++; i < count && !failed; i = next++) {
+                body(worker, i);
+            }
+        } catch (...) {
+            lock_guard<mutex> lock(errorMutex);
+            if (!error) error = current_exception();
+            failed = true;
+        }
+    };
+
+    vector<thread> pool;
+    pool.reserve(threads - 1);
+    for (unsigned w = 1; w < threads; ++w) pool.emplace_back(run, w);
+    run(0);
+    for (auto& t : pool) t.join();
+
+    if (error) rethrow_exception(error);
+}
+
+#endif
@@ -0,0 +1,80 @@
+#include "ReactiveState.h"
+#include <algorithm>
+
+int ReactiveState::add(double value, int plusRow, int minusRow, bool currentState) {
+    values.push_back(value);
+    plusRows.push_back(plusRow);
+    minusRows.push_back(minusRow);
+    currentStates.push_back(currentState ? 1 : 0);
+    states.push_back(0.0);
+    previousStates.push_back(0.0);
+    rates.push_back(0.0);
+    return size() - 1;
+}
+
+void ReactiveState::clear() {
+    values.clear();
+    plusRows.clear();
+    minusRows.clear();
+    currentStates.clear();
+    states.clear();
+    previousStates.clear();
+    rates.clear();
+    previousStep = 0.0;
+}
+
+void ReactiveState::companion(int slot, double h, double& g_eq, double& I_eq) const {
+    const double value = values[slot];
+    if (h == 0.0) {
+        g_eq = 0.0;
+        I_eq = 0.0;
+    } else if (method == IntegrationMethod::Trapezoidal && previousStep > 0) {
+        g_eq = 2.0 * value / h;
+        I_eq = g_eq * states[slot] + rates[slot];
+    } else if (method == IntegrationMethod::Gear2 && previousStep > 0) {
+        IntegrationCoefficients c = gear2Coefficients(h, previousStep);
+        g_eq = value * c.a0;
+        I_eq = -value * (c.a1 * states[slot] + c.a2 * previousStates[slot]);
+    } else {
+        g_eq = value / h;
+        I_eq = g_eq * states[slot];
+    }
+}
+
+// Same formulas as companion(), with the method chosen once per batch.
+void ReactiveState::companions(double h, double* g_eq, double* I_eq) const {
+    const int count = size();
+    if (h == 0.0) {
+        fill(g_eq, g_eq + count, 0.0);
+        fill(I_eq, I_eq + count, 0.0);
+    } else if (method == IntegrationMethod::Trapezoidal && previousStep > 0) {
+        for (int k = 0; k < count; ++k) {
+            g_eq[k] = 2.0 * values[k] / h;
+            I_eq[k] = g_eq[k] * states[k] + rates[k];
+        }
+    } else if (method == IntegrationMethod::Gear2 && previousStep > 0) {
+        IntegrationCoefficients c = gear2Coefficients(h, previousStep);
+        for (int k = 0; k < count; ++k) {
+            g_eq[k] = values[k] * c.a0;
+            I_eq[k] = -values[k] * (c.a1 * states[k] + c.a2 * previousStates[k]);
+        }
+    } else {
+        for (int k = 0; k < count; ++k) {
+            g_eq[k] = values[k] / h;
+            I_eq[k] = g_eq[k] * states[k];
+        }
+    }
+}
+
+void ReactiveState::accept(const VectorXd& x, double h) {
+    const int count = size();
+    for (int k = 0; k < count; ++k) {
+        double s = stateOf(k, x);
+        double g_eq, I_eq;
+        companion(k, h, g_eq, I_eq);
+        rates[k] = g_eq * s - I_eq;
+        previousStates[k] = states[k];
+        states[k] = s;
+    }
+    previousStep = h;
+}
@@ -0,0 +1,57 @@
+#ifndef REACTIVESTATE_H
+#define REACTIVESTATE_H
+
+#include <vector>
+#include <Eigen/Dense>
+#include "IntegrationMethod.h"
+
+using namespace std;
+using namespace Eigen;
+
+// Integration history of the capacitors and inductors of an analysed circuit, owned by the
+// circuit as contiguous arrays indexed by device slot rather than spread over the devices.
+// Both kinds are described by a state s with rate = value * ds/dt: a capacitor's voltage with
+// its current as rate, an inductor's current with its voltage as rate. Every companion model
+// is then rate = g_eq * s - I_eq, and accepting a time point is one gather of s from x.
+class ReactiveState {
+public:
+    // Adds a device whose state is x(plusRow) - x(minusRow), a row of -1 reading as 0, and
+    // returns its slot. currentState selects abstol instead of vntol for its error tolerance.
+    int add(double value, int plusRow, int minusRow, bool currentState);
+    void clear();
+    int size() const { return static_cast<int>(values.size()); }
+
+    void setMethod(IntegrationMethod m) { method = m; }
+    // The next step uses backward Euler, as after a breakpoint; the states are kept.
+    void restart() { previousStep = 0.0; }
+    // Step of the last accepted point, 0 right after a restart.
+    double lastStep() const { return previousStep; }
+
+    // Companion model of a slot for a step h from the last accepted point. h = 0 gives the DC
+    // model g_eq = I_eq = 0, where every rate vanishes: capacitors open, inductors 0 V branches.
+    void companion(int slot, double h, double& g_eq, double& I_eq) const;
+    // The companion models of all slots at once, into arrays of size().
+    void companions(double h, double* g_eq, double* I_eq) const;
+    double stateOf(int slot, const VectorXd& x) const {
+        double plus = plusRows[slot] >= 0 ? x(plusRows[slot]) : 0.0;
+        double minus = minusRows[slot] >= 0 ? x(minusRows[slot]) : 0.0;
+        return plus - minus;
+    }
+    bool isCurrentState(int slot) const { return currentStates[slot] != 0; }
+    // Moves the history to a time point x accepted with step h.
+    void accept(const VectorXd& x, double h);
+
+private:
+    IntegrationMethod method = IntegrationMethod::BackwardEuler;
+    double previousStep = 0.0;
+    vector<double> values;
+    vector<int> plusRows;
+    vector<int> minusRows;
+    vector<char> currentStates;
+    // The state at the last and the one before last accepted point, and the rate at the last.
+    vector<double> states;
+    vector<double> previousStates;
+    vector<double> rates;
+};
+
+#endif
@@ -0,0 +1,46 @@
+#include "ResultStore.h"
+
+void ResultStore::clear() {
+    named.clear();
+    ids.clear();
+    columns.clear();
+    keyValues = nullptr;
+    rowColumns.clear();
+    rowSources.clear();
+}
+
+int ResultStore::add(const string& name) {
+    auto it = ids.find(name);
+    if (it != ids.end()) return it->second;
+    int id = static_cast<int>(columns.size());
+    columns.push_back(&named[name]);
+    ids.emplace(name, id);
+    return id;
+}
+
+int ResultStore::find(const string& name) const {
+    auto it = ids.find(name);
+    return it == ids.end() ? -1 : it->second;
+}
+
+void ResultStore::setRowLayout(int keyColumn, const vector<int>& columnIds, const vector<int>& xRows) {
+    keyValues = columns[keyColumn];
+    rowColumns.clear();
+    for (int id : columnIds) rowColumns.push_back(columns[id]);
+    rowSources = xRows;
+}
+
+void ResultStore::reserveRows(size_t rows) {
+    if (!keyValues) return;
+    keyValues->reserve(keyValues->size() + rows);
+    for (vector<double>* values : rowColumns) values->reserve(values->size() + rows);
+}
+
+void ResultStore::appendRow(double key, const VectorXd& x) {
+    keyValues->push_back(key);
+    const double* source = x.data();
+    const size_t count = rowColumns.size();
+    for (size_t k = 0; k < count; ++k) {
+        rowColumns[k]->push_back(source[rowSources[k]]);
+    }
+}
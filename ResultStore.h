@@ -0,0 +1,51 @@
+#ifndef RESULTSTORE_H
+#define RESULTSTORE_H
+
+#include <vector>
+#include <string>
+#include <map>
+#include <Eigen/Dense>
+
+using namespace std;
+using namespace Eigen;
+
+// Analysis results as named columns of doubles ("Time", "V(3)", "I(L1)", ...). Each column
+// gets an integer id when it is added, and a row recorder maps x rows to column ids once, so
+// recording a time point is one indexed copy per signal into reserved storage with no name
+// building or map lookup. The name index is a map, which the GUI and CLI read directly.
+class ResultStore {
+public:
+    void clear();
+    // Id of the column called name, adding an empty column if there is none.
+    int add(const string& name);
+    // Id of the column called name, or -1.
+    int find(const string& name) const;
+    vector<double>& column(int id) { return *columns[id]; }
+    const vector<double>& column(int id) const { return *columns[id]; }
+    // The column called name, added if missing, as map::operator[] does.
+    vector<double>& operator[](const string& name) { return column(add(name)); }
+
+    // Row recording: appendRow(key, x) appends key to keyColumn and x(xRows[k]) to
+    // columnIds[k] for every k.
+    void setRowLayout(int keyColumn, const vector<int>& columnIds, const vector<int>& xRows);
+    // Reserves room for rows more values in every column of the row layout.
+    void reserveRows(size_t rows);
+    void appendRow(double key, const VectorXd& x);
+
+    const map<string, vector<double>>& byName() const { return named; }
+    map<string, vector<double>>::iterator begin() { return named.begin(); }
+    map<string, vector<double>>::iterator end() { return named.end(); }
+    map<string, vector<double>>::const_iterator begin() const { return named.begin(); }
+    map<string, vector<double>>::const_iterator end() const { return named.end(); }
+
+private:
+    // Map nodes never move, so columns[id] stays valid until clear().
+    map<string, vector<double>> named;
+    map<string, int> ids;
+    vector<vector<double>*> columns;
+    vector<double>* keyValues = nullptr;
+    vector<vector<double>*> rowColumns;
+    vector<int> rowSources;
+};
+
+#endif
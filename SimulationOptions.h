@@ -0,0 +1,48 @@
+#ifndef SIMULATIONOPTIONS_H
+#define SIMULATIONOPTIONS_H
+
+#include "LinearSolver.h"
+#include "IntegrationMethod.h"
+
+// Analysis settings that are not part of the netlist itself. Set from the CLI with
+// "option <name> <value>" and from the simulation dialog.
+struct SimulationOptions {
+    LinearSolverType transientSolver = LinearSolverType::Auto;
+    LinearSolverType acSolver = LinearSolverType::Auto;
+    LinearSolverType dcSolver = LinearSolverType::Auto;
+    MatrixOrdering ordering = MatrixOrdering::COLAMD;
+    IntegrationMethod integration = IntegrationMethod::BackwardEuler;
+    // Transient time-step control. With adaptiveStep the step follows the local truncation
+    // error of the reactive states, bounded by trtol * (reltol * |value| + vntol or abstol),
+    // and never grows past Tstep; off steps at a fixed Tstep. reltol, vntol and abstol are
+    // also the per-variable Newton convergence tolerances.
+    bool adaptiveStep = false;
+    double reltol = 1e-3;
+    double vntol = 1e-6;
+    double abstol = 1e-12;
+    double trtol = 7.0;
+    // Degree of the polynomial through the last accepted transient (or DC sweep) points that
+    // gives the Newton starting guess: 0 = previous solution, 1 = linear, 2 = quadratic.
+    int predictorOrder = 1;
+    // Largest node voltage change per Newton iteration in volts; longer updates are scaled
+    // back along their direction. 0 takes full Newton steps.
+    double newtonDamping = 0.0;
+    // Nonlinear devices whose junction voltage moved by less than reltol * |v| + bypassTolerance
+    // (volts) reuse their previous linearization. 0 evaluates every device on every iteration.
+    double bypassTolerance = 1e-6;
+    // DC operating point fallbacks when plain Newton fails. Gmin stepping starts with gminStart
+    // siemens from every node to ground and divides it by 10 per step down to gminFinal, then
+    // removes it; source stepping ramps all independent sources up in sourceSteps steps.
+    // 0 disables either homotopy.
+    double gminStart = 1e-2;
+    double gminFinal = 1e-12;
+    int sourceSteps = 10;
+    // With useInitialConditions (SPICE UIC, the default) transient analysis starts with every
+    // node voltage and reactive state at zero; turned off, it starts from the DC operating point.
+    bool useInitialConditions = true;
+    // Worker threads for AC sweeps and for the segments of nested DC sweeps; 0 uses every
+    // hardware thread.
+    int threads = 0;
+};
+
+#endif
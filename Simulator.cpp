@@ -4,8 +4,42 @@
 #include <set>
 #include <filesystem>
 #include <regex>
+#include <chrono>
+#include <iomanip>
 
 
+// Parses the tokenized output variables "V ( n )" and "I ( comp )" from tokens[first] on.
+static vector<PrintVariable> parsePrintVariables(const vector<string>& tokens, size_t first) {
+    vector<PrintVariable> printVars;
+    size_t vars_start_idx = first;
+    while (vars_start_idx < tokens.size()) {
+        const string& type_token = tokens[vars_start_idx];
+        char type;
+        if (type_token.length() == 1 && (toupper(type_token[0]) == 'V' || toupper(type_token[0]) == 'I')) {
+            type = toupper(type_token[0]);
+        } else {
+            throw runtime_error("Invalid variable format: '" + type_token + "'. Expected 'V' or 'I' to start a variable specification.");
+        }
+
+        if (vars_start_idx + 1 >= tokens.size() || tokens[vars_start_idx + 1] != "(") {
+            throw runtime_error("Invalid variable format for '" + type_token + "': Missing '('. Expected V(node) or I(comp).");
+        }
+
+        if (vars_start_idx + 2 >= tokens.size()) {
+            throw runtime_error("Invalid variable format: Missing node or component ID after '('.");
+        }
+        const string& id = tokens[vars_start_idx + 2];
+
+        if (vars_start_idx + 3 >= tokens.size() || tokens[vars_start_idx + 3] != ")") {
+            throw runtime_error("Invalid variable format: Missing ')' after ID '" + id + "'.");
+        }
+
+        printVars.push_back({type, id});
+        vars_start_idx += 4;
+    }
+    return printVars;
+}
+
 Simulator::Simulator() {
     setupDefaultModels();
 }
@@ -68,8 +102,11 @@ void Simulator::processCommand(const string& command_in) {
     else if (cmd == "gnd") handleGnd(tokens);
     else if (cmd == "show") handleShow(tokens);
     else if (cmd == "dc") handleDC(tokens);
+    else if (cmd == "op") handleOP(tokens);
+    else if (cmd == "bench") handleBench(tokens);
     else if (cmd == "help") handleHelp();
     else if (cmd == "save") handleSave(tokens);
+    else if (cmd == "option") handleOption(tokens);
     else throw runtime_error("Unknown command '" + tokens[0] + "'");
 }
 
@@ -302,33 +339,7 @@ void Simulator::handlePrint(const vector<string>& tokens) {
         vars_start_idx++;
     }
 
-    vector<PrintVariable> printVars;
-
-    while (vars_start_idx < tokens.size()) {
-        const string& type_token = tokens[vars_start_idx];
-        char type;
-        if (type_token.length() == 1 && (toupper(type_token[0]) == 'V' || toupper(type_token[0]) == 'I')) {
-            type = toupper(type_token[0]);
-        } else {
-            throw runtime_error("Invalid variable format: '" + type_token + "'. Expected 'V' or 'I' to start a variable specification.");
-        }
-
-        if (vars_start_idx + 1 >= tokens.size() || tokens[vars_start_idx + 1] != "(") {
-            throw runtime_error("Invalid variable format for '" + type_token + "': Missing '('. Expected V(node) or I(comp).");
-        }
-
-        if (vars_start_idx + 2 >= tokens.size()) {
-            throw runtime_error("Invalid variable format: Missing node or component ID after '('.");
-        }
-        const string& id = tokens[vars_start_idx + 2];
-
-        if (vars_start_idx + 3 >= tokens.size() || tokens[vars_start_idx + 3] != ")") {
-            throw runtime_error("Invalid variable format: Missing ')' after ID '" + id + "'.");
-        }
-
-        printVars.push_back({type, id});
-        vars_start_idx += 4;
-    }
+    vector<PrintVariable> printVars = parsePrintVariables(tokens, vars_start_idx);
 
     circuit.runTransientAnalysis(Tstop, Tstep, printVars, Tstart, Tmaxstep);
 }
@@ -404,54 +415,86 @@ void Simulator::handleShow(const vector<string>& tokens) {
 
 void Simulator::handleDC(const vector<string>& tokens) {
     if (tokens.size() < 5) {
-        throw runtime_error("Syntax error. Usage: DC <SrcName> <Start> <End> <Incr> [Var1] ...");
+        throw runtime_error("Syntax error. Usage: DC <SrcName> <Start> <End> <Incr> [<Src2> <Start2> <End2> <Incr2>] [Var1] ...");
     }
-    const string& srcName = tokens[1];
-    double start = parseValue(tokens[2]);
-    double end = parseValue(tokens[3]);
-    double incr = parseValue(tokens[4]);
+    DCSweepAxis outer{tokens[1], parseValue(tokens[2]), parseValue(tokens[3]), parseValue(tokens[4])};
+    if (outer.increment == 0) throw runtime_error("Increment for DC sweep cannot be zero.");
 
-    if (incr == 0) throw runtime_error("Increment for DC sweep cannot be zero.");
-
-    vector<PrintVariable> printVars;
+    // A second source before the variables makes it a nested sweep with the first one outer.
+    // Variables are tokenized as V ( n ), so anything after <Incr> not followed by "(" is a source.
     size_t vars_start_idx = 5;
-
-    // --- START OF BUG FIX ---
-    // This new loop correctly parses tokenized variables like "V", "(", "1", ")"
-    while (vars_start_idx < tokens.size()) {
-        const string& type_token = tokens[vars_start_idx];
-        char type;
-        if (type_token.length() == 1 && (toupper(type_token[0]) == 'V' || toupper(type_token[0]) == 'I')) {
-            type = toupper(type_token[0]);
-        } else {
-            throw runtime_error("Invalid variable format: '" + type_token + "'. Expected 'V' or 'I' to start a variable specification.");
-        }
-
-        if (vars_start_idx + 1 >= tokens.size() || tokens[vars_start_idx + 1] != "(") {
-            throw runtime_error("Invalid variable format for '" + type_token + "': Missing '('. Expected V(node) or I(comp).");
-        }
-
-        if (vars_start_idx + 2 >= tokens.size()) {
-            throw runtime_error("Invalid variable format: Missing node or component ID after '('.");
-        }
-        const string& id = tokens[vars_start_idx + 2];
-
-        if (vars_start_idx + 3 >= tokens.size() || tokens[vars_start_idx + 3] != ")") {
-            throw runtime_error("Invalid variable format: Missing ')' after ID '" + id + "'.");
-        }
-
-        printVars.push_back({type, id});
-        vars_start_idx += 4;
+    bool nested = tokens.size() > 5 && !(tokens.size() > 6 && tokens[6] == "(");
+    DCSweepAxis inner;
+    if (nested) {
+        if (tokens.size() < 9) throw runtime_error("Syntax error. A nested sweep needs <Src2> <Start2> <End2> <Incr2>.");
+        inner = {tokens[5], parseValue(tokens[6]), parseValue(tokens[7]), parseValue(tokens[8])};
+        if (inner.increment == 0) throw runtime_error("Increment for DC sweep cannot be zero.");
+        vars_start_idx = 9;
     }
-    // --- END OF BUG FIX ---
 
-    if (tokens.size() > 5 && printVars.empty()) {
+    vector<PrintVariable> printVars = parsePrintVariables(tokens, vars_start_idx);
+
+    if (tokens.size() > vars_start_idx && printVars.empty()) {
         // This check might be misleading now, but we can leave it.
         // It's hard to distinguish between "no variables provided" and "invalid variable format" without more complex logic.
         cout << "Warning: No valid variables found to print." << endl;
     }
 
-    circuit.runDCSweep(srcName, start, end, incr, printVars);
+    if (nested) circuit.runNestedDCSweep(outer, inner, printVars);
+    else circuit.runDCSweep(outer.source, outer.start, outer.end, outer.increment, printVars);
+}
+void Simulator::handleOP(const vector<string>& tokens) {
+    circuit.runOperatingPoint(parsePrintVariables(tokens, 1));
+}
+// Diode linearization microbenchmark: every diode through its own Diode::stamp() against one
+// DiodeArray batch (as used by the analyses), at the same spread of junction voltages.
+void Simulator::handleBench(const vector<string>& tokens) {
+    if (tokens.size() < 3 || tokens[1] != "diodes") {
+        throw runtime_error("Syntax error. Usage: bench diodes <count> [<iterations>]");
+    }
+    int count = stoi(tokens[2]);
+    int iterations = (tokens.size() > 3) ? stoi(tokens[3]) : 100;
+    if (count <= 0 || iterations <= 0) throw runtime_error("Count and iterations must be positive.");
+
+    const DiodeModel& model = diodeModels.at("D");
+    VectorXd vd(count);
+    vector<unique_ptr<Component>> diodes;
+    DiodeArray batch;
+    for (int k = 0; k < count; ++k) {
+        // Reverse bias up to forward conduction just below the limiting threshold.
+        vd(k) = -1.0 + 1.7 * ((k * 7919) % 1000) / 1000.0;
+        diodes.push_back(make_unique<Diode>("D" + to_string(k), k + 1, 0, model));
+        batch.add(model);
+    }
+    batch.reset(0.0, 0.0);
+
+    RealStamper discard;
+    VectorXd perDevice(count), batched(count);
+    auto start = chrono::steady_clock::now();
+    for (int it = 0; it < iterations; ++it) {
+        perDevice.setZero();
+        for (int k = 0; k < count; ++k) diodes[k]->stamp(discard, perDevice, vd, -1, 1.0, 0.0);
+    }
+    auto middle = chrono::steady_clock::now();
+    for (int it = 0; it < iterations; ++it) {
+        batched.setZero();
+        batch.evaluate(vd.data());
+        const double* Ieq = batch.currents();
+        for (int k = 0; k < count; ++k) batched(k) -= Ieq[k];
+    }
+    auto end = chrono::steady_clock::now();
+
+    double evaluations = static_cast<double>(count) * iterations;
+    double deviceNs = chrono::duration<double, nano>(middle - start).count() / evaluations;
+    double batchNs = chrono::duration<double, nano>(end - middle).count() / evaluations;
+    double difference = (perDevice - batched).cwiseAbs().maxCoeff() / max(perDevice.cwiseAbs().maxCoeff(), 1e-300);
+    cout << "Diode evaluation, " << count << " diodes x " << iterations << " iterations:" << endl;
+    cout << fixed << setprecision(2);
+    cout << "  per device: " << deviceNs << " ns/diode" << endl;
+    cout << "  batch:      " << batchNs << " ns/diode (" << deviceNs / batchNs << "x)" << endl;
+    cout << scientific << "  largest difference: " << difference << " (relative to the largest current)" << endl;
+    cout.unsetf(ios::floatfield);
+    cout << setprecision(6);
 }
 void Simulator::handleHelp() {
     cout << "--- Circuit Simulator Help ---" << endl;
@@ -480,9 +523,20 @@ void Simulator::handleHelp() {
     cout << "    - Lists all components in the circuit. Can be filtered by type (R, C, V, etc.)." << endl;
     cout << "    - Example: list or list C" << endl << endl;
 
-    cout << "  dc <Src> <Start> <End> <Incr> <Var1> ... " << endl;
+    cout << "  dc <Src> <Start> <End> <Incr> [<Src2> <Start2> <End2> <Incr2>] <Var1> ... " << endl;
     cout << "    - Performs a DC sweep analysis." << endl;
-    cout << "    - Example: dc Vs 0 10 0.5 V(2)" << endl << endl;
+    cout << "    - Example: dc Vs 0 10 0.5 V(2)" << endl;
+    cout << "    - A second source makes a nested sweep; the outer range is split across threads." << endl;
+    cout << "    - After <Incr>, a name followed by '(' is a variable; any other name is <Src2>." << endl;
+    cout << "    - Example: dc Vb 0 1 0.1 Vc 0 5 0.05 I(Vc)" << endl << endl;
+
+    cout << "  op [Var1] ..." << endl;
+    cout << "    - Computes the DC operating point, printing all or the given variables." << endl;
+    cout << "    - Example: op V(2) I(V1)" << endl << endl;
+
+    cout << "  bench diodes <count> [<iterations>]" << endl;
+    cout << "    - Times diode linearization per device against the batched evaluation." << endl;
+    cout << "    - Example: bench diodes 10000 100" << endl << endl;
 
     cout << "  run <EndTime> <TimeStep>" << endl;
     cout << "    - Runs a simple transient analysis, printing all variables." << endl;
@@ -507,6 +561,22 @@ void Simulator::handleHelp() {
     cout << "    - Saves the current manually built circuit to a netlist file." << endl << endl;
 
 
+    cout << "  option [<name> <value>]" << endl;
+    cout << "    - Sets an analysis option, or lists all options when called without arguments." << endl;
+    cout << "    - solver | tran_solver | ac_solver | dc_solver: auto, lu, fullpivlu, sparselu, sparseqr, bicgstab" << endl;
+    cout << "    - ordering: colamd, amd, rcm, natural (fill-reducing order for the sparse solvers)" << endl;
+    cout << "    - threads: worker threads for AC and nested DC sweeps, 0 = all hardware threads" << endl;
+    cout << "    - method: be, trap, gear2 (capacitor/inductor integration in transient analysis)" << endl;
+    cout << "    - adaptive: on | off (LTE-controlled transient step of at most Tstep, off by default)" << endl;
+    cout << "    - reltol | vntol | abstol | trtol: truncation error and Newton convergence tolerances" << endl;
+    cout << "    - predictor: off | linear | quadratic (Newton starting guess in transient analysis and DC sweeps)" << endl;
+    cout << "    - damping: off | <volts> (largest node voltage change per Newton iteration)" << endl;
+    cout << "    - bypass: off | <volts> (junction voltage change below which a diode reuses its last stamp)" << endl;
+    cout << "    - gmin: off | <siemens> (starting node shunt of the operating point gmin stepping)" << endl;
+    cout << "    - srcsteps: off | <count> (source stepping steps when gmin stepping fails)" << endl;
+    cout << "    - uic: on | off (on, the default, starts transient analysis from zero; off from the DC operating point)" << endl;
+    cout << "    - Example: option tran_solver sparselu" << endl << endl;
+
     cout << "  reset" << endl;
     cout << "    - Clears the current circuit." << endl << endl;
 
@@ -542,4 +612,108 @@ void Simulator::handleSave(const vector<string>& tokens) {
 
     outFile.close();
     cout << "Circuit successfully saved to " << filename << endl;
-}
\ No newline at end of file
+}
+
+void Simulator::handleOption(const vector<string>& tokens) {
+    SimulationOptions& options = circuit.getOptions();
+    if (tokens.size() == 1) {
+        cout << "tran_solver = " << linearSolverTypeName(options.transientSolver) << endl;
+        cout << "ac_solver   = " << linearSolverTypeName(options.acSolver) << endl;
+        cout << "dc_solver   = " << linearSolverTypeName(options.dcSolver) << endl;
+        cout << "ordering    = " << matrixOrderingName(options.ordering) << endl;
+        cout << "threads     = " << options.threads << (options.threads == 0 ? " (auto)" : "") << endl;
+        cout << "method      = " << integrationMethodName(options.integration) << endl;
+        cout << "adaptive    = " << (options.adaptiveStep ? "on" : "off") << endl;
+        cout << "reltol      = " << options.reltol << endl;
+        cout << "vntol       = " << options.vntol << endl;
+        cout << "abstol      = " << options.abstol << endl;
+        cout << "trtol       = " << options.trtol << endl;
+        static const char* predictorNames[] = {"off", "linear", "quadratic"};
+        cout << "predictor   = " << predictorNames[options.predictorOrder] << endl;
+        cout << "damping     = " << (options.newtonDamping > 0 ? to_string(options.newtonDamping) + " V" : "off") << endl;
+        cout << "bypass      = " << (options.bypassTolerance > 0 ? to_string(options.bypassTolerance) + " V" : "off") << endl;
+        cout << "gmin        = " << (options.gminStart > 0 ? to_string(options.gminStart) + " S" : "off") << endl;
+        cout << "srcsteps    = " << (options.sourceSteps > 0 ? to_string(options.sourceSteps) : "off") << endl;
+        cout << "uic         = " << (options.useInitialConditions ? "on" : "off") << endl;
+        return;
+    }
+    if (tokens.size() != 3) {
+        throw runtime_error("Syntax: option <name> <value>");
+    }
+
+    string name = tokens[1];
+    transform(name.begin(), name.end(), name.begin(), ::tolower);
+    const string& value = tokens[2];
+
+    if (name == "solver") {
+        LinearSolverType type = parseLinearSolverType(value);
+        options.transientSolver = type;
+        options.acSolver = type;
+        options.dcSolver = type;
+    } else if (name == "tran_solver") {
+        options.transientSolver = parseLinearSolverType(value);
+    } else if (name == "ac_solver") {
+        options.acSolver = parseLinearSolverType(value);
+    } else if (name == "dc_solver") {
+        options.dcSolver = parseLinearSolverType(value);
+    } else if (name == "ordering") {
+        options.ordering = parseMatrixOrdering(value);
+    } else if (name == "threads") {
+        int threads = stoi(value);
+        if (threads < 0) throw runtime_error("threads must be 0 (auto) or a positive count.");
+        options.threads = threads;
+    } else if (name == "method") {
+        options.integration = parseIntegrationMethod(value);
+    } else if (name == "adaptive") {
+        string flag = value;
+        transform(flag.begin(), flag.end(), flag.begin(), ::tolower);
+        if (flag != "on" && flag != "off") throw runtime_error("adaptive must be on or off.");
+        options.adaptiveStep = (flag == "on");
+    } else if (name == "reltol" || name == "vntol" || name == "abstol" || name == "trtol") {
+        double tolerance = parseValue(value);
+        if (tolerance <= 0) throw runtime_error(name + " must be positive.");
+        if (name == "reltol") options.reltol = tolerance;
+        else if (name == "vntol") options.vntol = tolerance;
+        else if (name == "abstol") options.abstol = tolerance;
+        else options.trtol = tolerance;
+    } else if (name == "predictor") {
+        string flag = value;
+        transform(flag.begin(), flag.end(), flag.begin(), ::tolower);
+        if (flag == "off") options.predictorOrder = 0;
+        else if (flag == "linear") options.predictorOrder = 1;
+        else if (flag == "quadratic") options.predictorOrder = 2;
+        else throw runtime_error("predictor must be off, linear or quadratic.");
+    } else if (name == "damping") {
+        string flag = value;
+        transform(flag.begin(), flag.end(), flag.begin(), ::tolower);
+        double limit = (flag == "off") ? 0.0 : parseValue(value);
+        if (limit < 0) throw runtime_error("damping must be off or a positive voltage.");
+        options.newtonDamping = limit;
+    } else if (name == "bypass") {
+        string flag = value;
+        transform(flag.begin(), flag.end(), flag.begin(), ::tolower);
+        double tolerance = (flag == "off") ? 0.0 : parseValue(value);
+        if (tolerance < 0) throw runtime_error("bypass must be off or a positive voltage.");
+        options.bypassTolerance = tolerance;
+    } else if (name == "gmin") {
+        string flag = value;
+        transform(flag.begin(), flag.end(), flag.begin(), ::tolower);
+        double start = (flag == "off") ? 0.0 : parseValue(value);
+        if (start < 0) throw runtime_error("gmin must be off or a positive conductance.");
+        options.gminStart = start;
+    } else if (name == "srcsteps") {
+        string flag = value;
+        transform(flag.begin(), flag.end(), flag.begin(), ::tolower);
+        int steps = (flag == "off") ? 0 : stoi(value);
+        if (steps < 0) throw runtime_error("srcsteps must be off or a positive count.");
+        options.sourceSteps = steps;
+    } else if (name == "uic") {
+        string flag = value;
+        transform(flag.begin(), flag.end(), flag.begin(), ::tolower);
+        if (flag != "on" && flag != "off") throw runtime_error("uic must be on or off.");
+        options.useInitialConditions = (flag == "on");
+    } else {
+        throw runtime_error("Unknown option '" + tokens[1] + "'");
+    }
+    cout << "Option " << name << " set to " << value << endl;
+}
@@ -35,8 +35,11 @@ private:
     void handleGnd(const vector<string>& tokens);
     void handleShow(const vector<string>& tokens);
     void handleDC(const vector<string>& tokens);
+    void handleOP(const vector<string>& tokens);
+    void handleBench(const vector<string>& tokens);
     void handleHelp();
     void handleSave(const vector<string>& tokens);
+    void handleOption(const vector<string>& tokens);
 
     void addComponentFromTokens(const vector<string>& args);
 
@@ -0,0 +1,71 @@
+#include "StampPlan.h"
+#include <stdexcept>
+#include <algorithm>
+
+StampPlan::StampPlan(int matrix_size, bool dense, const vector<Triplet<double>>& recorded, const vector<int>& componentBegin)
+        : size(matrix_size), dense(dense), componentBegin(componentBegin) {
+    slots.resize(recorded.size());
+    if (dense) {
+        denseMatrix = MatrixXd::Zero(size, size);
+        values = denseMatrix.data();
+        for (size_t k = 0; k < recorded.size(); ++k) {
+            slots[k] = recorded[k].row() + recorded[k].col() * size;
+        }
+        return;
+    }
+
+    sparseMatrix.resize(size, size);
+    sparseMatrix.setFromTriplets(recorded.begin(), recorded.end());
+    sparseMatrix.makeCompressed();
+    values = sparseMatrix.valuePtr();
+    for (size_t k = 0; k < recorded.size(); ++k) {
+        slots[k] = slotOf(recorded[k].row(), recorded[k].col());
+    }
+}
+
+int StampPlan::slotOf(int row, int col) const {
+    if (dense) return row + col * size;
+    const int* outer = sparseMatrix.outerIndexPtr();
+    const int* inner = sparseMatrix.innerIndexPtr();
+    const int* first = inner + outer[col];
+    const int* last = inner + outer[col + 1];
+    const int* it = lower_bound(first, last, row);
+    if (it == last || *it != row) throw logic_error("Matrix entry is not part of the compiled stamp plan.");
+    return static_cast<int>(it - inner);
+}
+
+long StampPlan::nonZeros() const {
+    return dense ? static_cast<long>(size) * size : sparseMatrix.nonZeros();
+}
+
+size_t StampPlan::valueCount() const {
+    return dense ? static_cast<size_t>(size) * size : static_cast<size_t>(sparseMatrix.nonZeros());
+}
+
+void StampPlan::clearValues() {
+    fill(values, values + valueCount(), 0.0);
+}
+
+void StampPlan::saveValues(vector<double>& snapshot) const {
+    snapshot.assign(values, values + valueCount());
+}
+
+void StampPlan::restoreValues(const vector<double>& snapshot) {
+    copy(snapshot.begin(), snapshot.end(), values);
+}
+
+RealStamper StampPlan::stamperFor(size_t componentIndex) {
+    return RealStamper(values, slots.data() + componentBegin[componentIndex]);
+}
+
+void StampPlan::checkStamped(size_t componentIndex, const RealStamper& stamper) const {
+    if (stamper.nextSlot() != slots.data() + componentBegin[componentIndex + 1]) {
+        throw logic_error("Component stamp does not match its compiled stamp plan.");
+    }
+}
+
+void StampPlan::factorize(LinearSolver<double>& solver, bool samePattern) const {
+    if (dense) solver.factorize(denseMatrix);
+    else if (samePattern) solver.refactorize(sparseMatrix);
+    else solver.factorize(sparseMatrix);
+}
@@ -0,0 +1,59 @@
+#ifndef STAMPPLAN_H
+#define STAMPPLAN_H
+
+#include <vector>
+#include <Eigen/Dense>
+#include <Eigen/Sparse>
+#include "MNAStamper.h"
+#include "LinearSolver.h"
+
+using namespace std;
+using namespace Eigen;
+
+// Precompiled mapping from every component's stamp writes to fixed offsets in the value
+// array of the MNA matrix (the SPICE pointer-stamping trick). The plan is built once from a
+// recorded stamp pass; after that each assembly is a run of indexed adds over a flat array,
+// with no index arithmetic, ground tests or sparse lookups. It relies on every component
+// issuing the same sequence of add() calls on each stamp, which all stamps in Component.cpp do.
+class StampPlan {
+public:
+    // recorded holds the triplets of one stamp pass over all components; componentBegin[i] is
+    // the index of component i's first triplet, with one trailing entry for the end.
+    StampPlan(int matrix_size, bool dense, const vector<Triplet<double>>& recorded, const vector<int>& componentBegin);
+    // values points into the owned matrix storage, so a plan stays where it was built.
+    StampPlan(const StampPlan&) = delete;
+    StampPlan& operator=(const StampPlan&) = delete;
+
+    bool isDense() const { return dense; }
+    long nonZeros() const;
+    // Offset of entry (row, col) in the value array; throws if no component stamps it.
+    int slotOf(int row, int col) const;
+    // The value array itself, for kernels that write precompiled slots in bulk.
+    double* valueData() { return values; }
+
+    void clearValues();
+    // Snapshots of the value array, used to keep the linear part of the matrix between assemblies.
+    void saveValues(vector<double>& snapshot) const;
+    void restoreValues(const vector<double>& snapshot);
+    // Stamper that writes component i's entries into their precompiled slots.
+    RealStamper stamperFor(size_t componentIndex);
+    // Throws if component i wrote a different number of entries than it did when recorded.
+    void checkStamped(size_t componentIndex, const RealStamper& stamper) const;
+
+    // samePattern: the solver last factorized this plan's matrix, so a sparse solver may
+    // keep its symbolic analysis.
+    void factorize(LinearSolver<double>& solver, bool samePattern = false) const;
+
+private:
+    size_t valueCount() const;
+
+    int size;
+    bool dense;
+    MatrixXd denseMatrix;
+    SparseMatrix<double> sparseMatrix;
+    double* values = nullptr;
+    vector<int> slots;
+    vector<int> componentBegin;
+};
+
+#endif
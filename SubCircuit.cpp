@@ -22,11 +22,11 @@ void SubCircuit::print() const {
     std::cout << ")" << std::endl;
 }
 
-void SubCircuit::stamp(MatrixXd&, VectorXd&, const VectorXd&, int, double, double) {
+void SubCircuit::stamp(RealStamper&, VectorXd&, const VectorXd&, int, double, double) {
     throw std::logic_error("SubCircuit::stamp should not be called directly. Circuit should be flattened first.");
 }
 
-void SubCircuit::stampAC(MatrixXcd&, VectorXcd&, int, double) const {
+void SubCircuit::stampAC(ComplexStamper&, VectorXcd&, int, double) const {
     throw std::logic_error("SubCircuit::stampAC should not be called directly. Circuit should be flattened first.");
 }
 
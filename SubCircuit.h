@@ -17,8 +17,8 @@ public:
     unique_ptr<Component> clone() const override;
 
     void print() const override;
-    void stamp(MatrixXd& A, VectorXd& b, const VectorXd& x_prev_nr, int current_idx, double h, double t) override;
-    void stampAC(MatrixXcd& A, VectorXcd& b, int current_idx, double omega) const override;
+    void stamp(RealStamper& A, VectorXd& b, const VectorXd& x_prev_nr, int current_idx, double h, double t) override;
+    void stampAC(ComplexStamper& A, VectorXcd& b, int current_idx, double omega) const override;
     string toNetlistString() const override;
 
     unique_ptr<Circuit> loadInternalCircuit() const;
@@ -581,6 +581,13 @@ void MainWindow::onRunSimulation() {
 
             qDebug() << "[DEBUG] Starting analysis...";
 
+            SimulationOptions& options = circuit->getOptions();
+            options.transientSolver = parseLinearSolverType(simDialog.getTransientSolver());
+            options.integration = parseIntegrationMethod(simDialog.getIntegrationMethod());
+            options.adaptiveStep = simDialog.getAdaptiveStep();
+            options.useInitialConditions = !simDialog.getStartFromOperatingPoint();
+            options.acSolver = parseLinearSolverType(tabIndex == 2 ? simDialog.getPhaseSolver() : simDialog.getAcSolver());
+
             if (tabIndex == 0) {
                 circuit->runTransientAnalysis(simDialog.getStopTime(), simDialog.getTimeStep(), {}, simDialog.getStartTime());
                 xAxisTitle = "Time (s)";
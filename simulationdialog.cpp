@@ -5,6 +5,7 @@
 #include <QTabWidget>
 #include <QLineEdit>
 #include <QComboBox>
+#include <QCheckBox>
 #include <QDialogButtonBox>
 #include <QLabel>
 #include <QWidget>
@@ -30,6 +31,13 @@ SimulationDialog::SimulationDialog(QWidget *parent)
     setLayout(mainLayout);
 }
 
+QComboBox* SimulationDialog::createSolverCombo()
+{
+    QComboBox *combo = new QComboBox;
+    combo->addItems({"auto", "lu", "fullpivlu", "sparselu", "sparseqr", "bicgstab"});
+    return combo;
+}
+
 void SimulationDialog::createTransientTab()
 {
     QWidget *transientTab = new QWidget;
@@ -38,10 +46,19 @@ void SimulationDialog::createTransientTab()
     stopTimeEdit = new QLineEdit("1m");
     startTimeEdit = new QLineEdit("0");
     timeStepEdit = new QLineEdit("1u");
+    transientSolverCombo = createSolverCombo();
+    integrationCombo = new QComboBox;
+    integrationCombo->addItems({"be", "trap", "gear2"});
+    adaptiveStepCheck = new QCheckBox;
+    operatingPointCheck = new QCheckBox;
 
     formLayout->addRow(new QLabel(tr("Stop Time:")), stopTimeEdit);
     formLayout->addRow(new QLabel(tr("Time to start saving data:")), startTimeEdit);
     formLayout->addRow(new QLabel(tr("Time Step:")), timeStepEdit);
+    formLayout->addRow(new QLabel(tr("Linear Solver:")), transientSolverCombo);
+    formLayout->addRow(new QLabel(tr("Integration Method:")), integrationCombo);
+    formLayout->addRow(new QLabel(tr("Adaptive Time Step:")), adaptiveStepCheck);
+    formLayout->addRow(new QLabel(tr("Start from DC Operating Point:")), operatingPointCheck);
 
     transientTab->setLayout(formLayout);
     tabWidget->addTab(transientTab, tr("Transient"));
@@ -57,11 +74,13 @@ void SimulationDialog::createAcSweepTab()
     numPointsEdit = new QLineEdit("100");
     sweepTypeCombo = new QComboBox;
     sweepTypeCombo->addItems({"Linear", "Decade", "Octave"});
+    acSolverCombo = createSolverCombo();
 
     formLayout->addRow(new QLabel(tr("Start Frequency (Hz):")), startFreqEdit);
     formLayout->addRow(new QLabel(tr("Stop Frequency (Hz):")), stopFreqEdit);
     formLayout->addRow(new QLabel(tr("Number of Points:")), numPointsEdit);
     formLayout->addRow(new QLabel(tr("Sweep Type:")), sweepTypeCombo);
+    formLayout->addRow(new QLabel(tr("Linear Solver:")), acSolverCombo);
 
     acTab->setLayout(formLayout);
     tabWidget->addTab(acTab, tr("AC Sweep"));
@@ -75,11 +94,13 @@ void SimulationDialog::createPhaseSweepTab()
     startPhaseEdit = new QLineEdit("0");
     stopPhaseEdit = new QLineEdit("360");
     numPointsPhaseEdit = new QLineEdit("100");
+    phaseSolverCombo = createSolverCombo();
 
     formLayout->addRow(new QLabel(tr("Base Frequency (Hz):")), baseFreqEdit);
     formLayout->addRow(new QLabel(tr("Start Phase (deg):")), startPhaseEdit);
     formLayout->addRow(new QLabel(tr("Stop Phase (deg):")), stopPhaseEdit);
     formLayout->addRow(new QLabel(tr("Number of Points:")), numPointsPhaseEdit);
+    formLayout->addRow(new QLabel(tr("Linear Solver:")), phaseSolverCombo);
 
     phaseTab->setLayout(formLayout);
     tabWidget->addTab(phaseTab, tr("Phase Sweep"));
@@ -100,3 +121,10 @@ double SimulationDialog::getBaseFreq() const { return parseValue(baseFreqEdit->t
 double SimulationDialog::getStartPhase() const { return parseValue(startPhaseEdit->text().toStdString()); }
 double SimulationDialog::getStopPhase() const { return parseValue(stopPhaseEdit->text().toStdString()); }
 int SimulationDialog::getNumPointsPhase() const { return numPointsPhaseEdit->text().toInt(); }
+
+std::string SimulationDialog::getTransientSolver() const { return transientSolverCombo->currentText().toStdString(); }
+std::string SimulationDialog::getIntegrationMethod() const { return integrationCombo->currentText().toStdString(); }
+bool SimulationDialog::getAdaptiveStep() const { return adaptiveStepCheck->isChecked(); }
+bool SimulationDialog::getStartFromOperatingPoint() const { return operatingPointCheck->isChecked(); }
+std::string SimulationDialog::getAcSolver() const { return acSolverCombo->currentText().toStdString(); }
+std::string SimulationDialog::getPhaseSolver() const { return phaseSolverCombo->currentText().toStdString(); }
@@ -7,6 +7,7 @@
 class QTabWidget;
 class QLineEdit;
 class QComboBox;
+class QCheckBox;
 class QDialogButtonBox;
 
 class SimulationDialog : public QDialog
@@ -34,11 +35,23 @@ public:
     double getStopPhase() const;
     int getNumPointsPhase() const;
 
+    // Linear solver selected on each tab ("auto", "lu", "sparselu", ...)
+    std::string getTransientSolver() const;
+    std::string getAcSolver() const;
+    std::string getPhaseSolver() const;
+    // Transient integration method ("be", "trap", "gear2")
+    std::string getIntegrationMethod() const;
+    // LTE-controlled transient step (at most the Time Step) instead of a fixed one
+    bool getAdaptiveStep() const;
+    // Start the transient run from the DC operating point instead of from zero
+    bool getStartFromOperatingPoint() const;
+
 
 private:
     void createTransientTab();
     void createAcSweepTab();
     void createPhaseSweepTab();
+    QComboBox* createSolverCombo();
 
     QTabWidget *tabWidget;
     QDialogButtonBox *buttonBox;
@@ -47,17 +60,23 @@ private:
     QLineEdit *stopTimeEdit;
     QLineEdit *startTimeEdit;
     QLineEdit *timeStepEdit;
+    QComboBox *transientSolverCombo;
+    QComboBox *integrationCombo;
+    QCheckBox *adaptiveStepCheck;
+    QCheckBox *operatingPointCheck;
 
     // AC Sweep widgets
     QLineEdit *startFreqEdit;
     QLineEdit *stopFreqEdit;
     QLineEdit *numPointsEdit;
     QComboBox *sweepTypeCombo;
+    QComboBox *acSolverCombo;
 
     QLineEdit *baseFreqEdit;
     QLineEdit *startPhaseEdit;
     QLineEdit *stopPhaseEdit;
     QLineEdit *numPointsPhaseEdit;
+    QComboBox *phaseSolverCombo;
 };
 
 #endif // SIMULATIONDIALOG_H